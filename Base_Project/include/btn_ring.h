@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+//! \file btn_ring.h
+//!
+//! Timestamped button edges captured in the interrupt handler.
+//!
+//! A callback attached with BTN_AttachScheduled runs on a later pass of
+//! BDK_Schedule. Reading the button and the time there reports the state
+//! at that pass, not at the edge, and several edges before the pass come
+//! out as a single event. Here the button interrupt handlers record each
+//! edge with the cycle counter into a ring, and the main loop hands all
+//! recorded edges to a callback in one batch.
+//!
+//! The ring has one producer and one consumer. The producer is the button
+//! interrupts, which must share one interrupt priority so that they never
+//! preempt each other; the consumer is the main loop. The producer only
+//! writes head and the consumer only writes tail, so no locking or atomic
+//! read-modify-write is needed, only a barrier between the event data and
+//! the index that publishes it. An edge arriving while all BTNR_SIZE
+//! entries are in use is dropped and counted in \c overflow; the edges
+//! already recorded are kept.
+//!
+//! Define HOST_BUILD to use GCC atomics instead of the CMSIS barrier and to
+//! leave out the cycle counter, so the ring can be exercised with threads
+//! on a host.
+//-----------------------------------------------------------------------------
+#ifndef BTN_RING_H_
+#define BTN_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \brief Number of ring entries, a power of two. */
+#ifndef BTNR_SIZE
+#define BTNR_SIZE           32
+#endif
+
+/** \brief Direction of a button edge. */
+typedef enum {
+	BTNR_RELEASED = 0,
+	BTNR_PRESSED = 1
+} BTNR_Edge;
+
+/** \brief One recorded edge. */
+typedef struct {
+	uint32_t stamp;             /**< Cycle counter in the interrupt */
+	uint8_t button;             /**< ButtonName */
+	uint8_t edge;               /**< BTNR_Edge */
+} BTNR_Event;
+
+/** \brief Receives \p count consecutive edges, oldest first. */
+typedef void (*BTNR_Handler)(const BTNR_Event *events, unsigned count, void *arg);
+
+/** \brief Ring state. */
+typedef struct {
+	BTNR_Event events[BTNR_SIZE];
+	volatile uint32_t head;     /**< Next entry to write, producer only */
+	volatile uint32_t tail;     /**< Next entry to deliver, consumer only */
+	volatile uint32_t overflow; /**< Edges dropped by a full ring, producer only */
+	uint32_t delivered;         /**< Edges handed to handlers */
+} BTNR_Ring;
+
+#ifndef HOST_BUILD
+/** \brief Start the DWT cycle counter used by BTNR_Stamp. */
+void BTNR_DeviceInitialize(void);
+
+/** \brief Current cycle count, wraps at 2^32. */
+uint32_t BTNR_Stamp(void);
+#endif
+
+/** \brief Initialize \p r empty. */
+void BTNR_Init(BTNR_Ring *r);
+
+/** \brief Record an edge, producer side (button interrupt).
+ * \return false if the ring was full and the edge was dropped. */
+bool BTNR_Capture(BTNR_Ring *r, unsigned button, BTNR_Edge edge, uint32_t stamp);
+
+/** \brief true if edges are waiting for BTNR_Deliver. */
+bool BTNR_Pending(const BTNR_Ring *r);
+
+/** \brief Pass all recorded edges to \p handler, main loop only.
+ *
+ * The edges are passed in place, in at most two calls when they wrap
+ * around the end of the ring. Their entries are released when the handler
+ * returns. Edges recorded during a call are left for the next pass.
+ * \return Number of edges delivered.
+ */
+unsigned BTNR_Deliver(BTNR_Ring *r, BTNR_Handler handler, void *arg);
+
+#endif /* BTN_RING_H_ */
@@ -14,7 +14,15 @@
 #ifndef MAIN_H_
 #define MAIN_H_
 
-/** \brief Application callback for handling of Push Button events. */
-void PB_TransitionEvent(void *arg);
+#include "btn_ring.h"
+
+/** \brief Application callback for a batch of Push Button edges. */
+void PB_TransitionEvents(const BTNR_Event *events, unsigned count, void *arg);
+
+/** \brief Push Button press handler, runs in interrupt context. */
+void PB_PressedInt(void *arg);
+
+/** \brief Push Button release handler, runs in interrupt context. */
+void PB_ReleasedInt(void *arg);
 
 #endif /* MAIN_H_ */
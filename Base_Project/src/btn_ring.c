@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+//! \file btn_ring.c
+//!
+//! Timestamped button edges captured in the interrupt handler.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#ifndef HOST_BUILD
+#include <BDK.h>
+#endif
+#include "btn_ring.h"
+
+#define BTNR_MASK           (BTNR_SIZE - 1)
+
+#if (BTNR_SIZE & BTNR_MASK) != 0
+#error "BTNR_SIZE must be a power of two"
+#endif
+
+/* Reads of the other side's index happen before the entries are touched */
+static inline uint32_t BTNR_Load(const volatile uint32_t *p)
+{
+#ifdef HOST_BUILD
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+	uint32_t v = *p;
+
+	__DMB();
+	return v;
+#endif
+}
+
+/* The entries are written or read before the index moves */
+static inline void BTNR_Store(volatile uint32_t *p, uint32_t v)
+{
+#ifdef HOST_BUILD
+	__atomic_store_n(p, v, __ATOMIC_RELEASE);
+#else
+	__DMB();
+	*p = v;
+#endif
+}
+
+#ifndef HOST_BUILD
+
+void BTNR_DeviceInitialize(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t BTNR_Stamp(void)
+{
+	return DWT->CYCCNT;
+}
+
+#endif /* HOST_BUILD */
+
+void BTNR_Init(BTNR_Ring *r)
+{
+	r->head = 0;
+	r->tail = 0;
+	r->overflow = 0;
+	r->delivered = 0;
+}
+
+bool BTNR_Capture(BTNR_Ring *r, unsigned button, BTNR_Edge edge, uint32_t stamp)
+{
+	uint32_t head = r->head;
+	BTNR_Event *e;
+
+	if (head - BTNR_Load(&r->tail) >= BTNR_SIZE)
+	{
+		r->overflow++;
+		return false;
+	}
+
+	e = &r->events[head & BTNR_MASK];
+	e->stamp = stamp;
+	e->button = (uint8_t)button;
+	e->edge = (uint8_t)edge;
+	BTNR_Store(&r->head, head + 1);
+	return true;
+}
+
+bool BTNR_Pending(const BTNR_Ring *r)
+{
+	return r->head != r->tail;
+}
+
+unsigned BTNR_Deliver(BTNR_Ring *r, BTNR_Handler handler, void *arg)
+{
+	uint32_t tail = r->tail;
+	uint32_t count = BTNR_Load(&r->head) - tail;
+	uint32_t pos = tail & BTNR_MASK;
+	uint32_t first = (count < BTNR_SIZE - pos) ? count : BTNR_SIZE - pos;
+
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	handler(&r->events[pos], first, arg);
+	if (count > first)
+	{
+		handler(&r->events[0], count - first, arg);
+	}
+
+	BTNR_Store(&r->tail, tail + count);
+	r->delivered += count;
+	return count;
+}
@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+//! \file log.c
+//!
+//! Tokenized logger with deferred formatting.
+//!
+//! DataTransfer_RTT and Base_Project have copies of this file and log.h
+//! that must stay identical.
+//-----------------------------------------------------------------------------
+#include "log.h"
+
+#ifdef HOST_BUILD
+
+#include <stdio.h>
+
+/* Host builds write the records to stdout for Tools/log_decode */
+void LOG_Initialize(void)
+{
+}
+
+void LOG_Write(const uint32_t *words, unsigned count)
+{
+	fwrite(words, sizeof(uint32_t), count, stdout);
+}
+
+#else
+
+#include "SEGGER_RTT.h"
+
+static char log_buffer[LOG_BUFFER_SIZE];
+
+void LOG_Initialize(void)
+{
+	SEGGER_RTT_ConfigUpBuffer(LOG_RTT_CHANNEL, "Log", log_buffer, sizeof(log_buffer),
+			SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+}
+
+void LOG_Write(const uint32_t *words, unsigned count)
+{
+	SEGGER_RTT_Write(LOG_RTT_CHANNEL, words, count * sizeof(uint32_t));
+}
+
+#endif /* HOST_BUILD */
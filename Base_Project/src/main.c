@@ -16,12 +16,24 @@
 
 #include <stdio.h>
 #include "main.h"
+#include "log.h"
+#include "btn_ring.h"
+
+BTNR_Ring buttons;          // edges recorded by the button interrupts
+uint32_t buttons_lost;      // overflow count already reported
 
 int main(void)
 {
     /* Initialize BDK library, set system clock (default 8MHz). */
     BDK_Initialize();
 
+    /* Binary log records go to their own RTT channel, see log.h. */
+    LOG_Initialize();
+
+    /* Button edges are stamped with the cycle counter in the interrupt. */
+    BTNR_DeviceInitialize();
+    BTNR_Init(&buttons);
+
     /* Initialize all LEDs */
     LED_Initialize(LED_RED);
     LED_Initialize(LED_GREEN);
@@ -32,46 +44,82 @@ int main(void)
 
     /* AttachScheduled -> Callback will be scheduled and called by Kernel Scheduler. */
     /* AttachInt -> Callback will be called directly from interrupt routine. */
-    BTN_AttachScheduled(BTN_EVENT_TRANSITION, &PB_TransitionEvent, (void*)BTN0, BTN0);
+    /* The interrupt callbacks only record the edge, see PB_TransitionEvents. */
+    BTN_AttachInt(BTN_EVENT_PRESSED, &PB_PressedInt, (void*)BTN0, BTN0);
+    BTN_AttachInt(BTN_EVENT_RELEASED, &PB_ReleasedInt, (void*)BTN0, BTN0);
 
     BTN_Initialize(BTN1);
-    BTN_AttachScheduled(BTN_EVENT_TRANSITION, &PB_TransitionEvent, (void*)BTN1, BTN1);
+    BTN_AttachInt(BTN_EVENT_PRESSED, &PB_PressedInt, (void*)BTN1, BTN1);
+    BTN_AttachInt(BTN_EVENT_RELEASED, &PB_ReleasedInt, (void*)BTN1, BTN1);
 
 
-    printf("APP: Entering main loop.\r\n");
+    LOG("APP: Entering main loop.\r\n");
     while (1)
     {
         /* Execute any events that have occurred & refresh Watchdog timer. */
         BDK_Schedule();
 
-        SYS_WAIT_FOR_INTERRUPT;
+        /* All edges recorded since the last pass, in one batch. */
+        BTNR_Deliver(&buttons, &PB_TransitionEvents, NULL);
+
+        /* An edge recorded after the delivery keeps the core awake. */
+        __disable_irq();
+        if (!BTNR_Pending(&buttons))
+        {
+            SYS_WAIT_FOR_INTERRUPT;
+        }
+        __enable_irq();
     }
 
     return 0;
 }
 
-void PB_TransitionEvent(void *arg)
+void PB_PressedInt(void *arg)
 {
-    ButtonName btn = (ButtonName)arg;
+    BTNR_Capture(&buttons, (ButtonName)arg, BTNR_PRESSED, BTNR_Stamp());
+}
+
+void PB_ReleasedInt(void *arg)
+{
+    BTNR_Capture(&buttons, (ButtonName)arg, BTNR_RELEASED, BTNR_Stamp());
+}
 
-    switch (btn)
+void PB_TransitionEvents(const BTNR_Event *events, unsigned count, void *arg)
+{
+    /* Cycle stamp of the previous edge per button */
+    static uint32_t last_stamp[2];
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    uint32_t lost = buttons.overflow;
+
+    (void)arg;
+
+    if (lost != buttons_lost)
     {
-    case BTN0:
-        LED_Toggle(LED_RED);
-        break;
-    case BTN1:
-        LED_Toggle(LED_GREEN);
-        break;
-    default:
-        return;
+        LOG("PB: %lu button edges lost\r\n", (unsigned long)(lost - buttons_lost));
+        buttons_lost = lost;
     }
 
-    /* Read current Push Button state. */
-    bool button_pressed = BTN_Read(btn);
+    for (unsigned i = 0; i < count; i++)
+    {
+        const BTNR_Event *e = &events[i];
 
-    /* Print current button state to serial terminal. */
-    printf("PB: Button %s state: %s [%lu ms]\r\n", (btn == BTN0) ? "0" : "1",
-            (button_pressed == BTN_PRESSED) ? "PRESSED" : "RELEASED",
-            HAL_Time());
-}
+        switch (e->button)
+        {
+        case BTN0:
+            LED_Toggle(LED_RED);
+            break;
+        case BTN1:
+            LED_Toggle(LED_GREEN);
+            break;
+        default:
+            continue;
+        }
 
+        /* State and time as captured in the interrupt. */
+        LOG("PB: Button %s state: %s [cycle %lu, +%lu us]\r\n", (e->button == BTN0) ? "0" : "1",
+                (e->edge == BTNR_PRESSED) ? "PRESSED" : "RELEASED",
+                (unsigned long)e->stamp,
+                (unsigned long)((e->stamp - last_stamp[e->button]) / cycles_per_us));
+        last_stamp[e->button] = e->stamp;
+    }
+}
@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+//! \file bench.h
+//!
+//! Output backend benchmark harness.
+//!
+//! Sends the same frame through each backend a fixed number of times and
+//! turns the elapsed ticks into ms, bytes/s and cycles/byte. Results are
+//! formatted as one CSV table so the host side can parse them directly.
+//!
+//! The harness only depends on the C library; clock and backends are
+//! supplied by the caller, which lets it run on a Linux host with stubs.
+//!
+//! BENCH_JobRun is the same measurement as a coroutine (coroutine.h) that
+//! gives the main loop a turn whenever its CO_Slice is used up. Only the
+//! time spent sending is measured, the time between turns is not.
+//! BENCH_SweepJobRun does the same for BENCH_Sweep and also yields after
+//! every point.
+//-----------------------------------------------------------------------------
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+#include "latency.h"
+#include "coroutine.h"
+
+/** \brief Line length sufficient for BENCH_FormatHeader/BENCH_FormatRow. */
+#define BENCH_LINE_SIZE    128
+
+/** \brief Output path under test. Any callback except send may be NULL. */
+typedef struct {
+	const char *name;
+	void (*begin)(void);                            /**< Called before timing starts */
+	void (*send)(const char *frame, unsigned len);  /**< Send one frame */
+	void (*end)(void);                              /**< Called before timing stops */
+} BENCH_Backend;
+
+/** \brief Time source used for a run. */
+typedef struct {
+	uint32_t (*now)(void);  /**< Free running tick counter, wraps at 2^32 */
+	uint32_t tick_hz;       /**< Tick rate of now() */
+	uint32_t core_hz;       /**< CPU clock used for cycles/byte */
+} BENCH_Clock;
+
+/** \brief Result of one backend run. */
+typedef struct {
+	const char *backend;
+	uint32_t frame_len;
+	uint32_t loops;
+	uint32_t bytes;
+	uint32_t ticks;
+	uint32_t us;
+	uint32_t bytes_per_s;
+	uint32_t cycles_per_byte_x100;  /**< Cycles per byte, fixed point 2 decimals */
+} BENCH_Result;
+
+/** \brief Value range stepped by a sweep: v, v * mul + add, ... up to last. */
+typedef struct {
+	uint32_t first;
+	uint32_t last;
+	uint32_t mul;
+	uint32_t add;
+} BENCH_Range;
+
+/** \brief Points measured by BENCH_Sweep. */
+typedef struct {
+	BENCH_Range size;   /**< Payload bytes per frame */
+	BENCH_Range loops;  /**< Frames sent per run */
+} BENCH_SweepConfig;
+
+/** \brief Build the frame for a payload of \p size bytes.
+ * Returns the frame length and sets \p frame. */
+typedef unsigned (*BENCH_PrepareFunc)(unsigned size, const char **frame);
+
+/** \brief Receives each result as soon as it is measured. */
+typedef void (*BENCH_EmitFunc)(const BENCH_Result *result);
+
+/** \brief Send \p frame \p loops times through \p backend and measure it.
+ *
+ * If \p latency is not NULL every send call is timed and recorded into it;
+ * the total then includes the two extra clock reads per frame.
+ */
+void BENCH_Run(const BENCH_Backend *backend, const BENCH_Clock *clock,
+		const char *frame, unsigned len, unsigned loops, BENCH_Result *result,
+		LAT_Histogram *latency);
+
+/** \brief Resumable BENCH_Run, see BENCH_JobInit. */
+typedef struct {
+	const BENCH_Backend *backend;
+	const BENCH_Clock *clock;
+	const char *frame;
+	unsigned len;
+	unsigned loops;
+	BENCH_Result *result;
+	LAT_Histogram *latency;
+	unsigned i;                 /**< Frames sent so far */
+	uint32_t start;             /**< Start of the running turn */
+	uint32_t ticks;             /**< Ticks of the completed turns */
+	CO_State co;
+} BENCH_Job;
+
+/** \brief Prepare \p job for BENCH_JobRun, same arguments as BENCH_Run. */
+void BENCH_JobInit(BENCH_Job *job, const BENCH_Backend *backend, const BENCH_Clock *clock,
+		const char *frame, unsigned len, unsigned loops, BENCH_Result *result,
+		LAT_Histogram *latency);
+
+/** \brief Send frames until \p slice is used up or the run is complete.
+ *
+ * The slice is restarted at the start of every call. The result is filled
+ * in when CO_DONE is returned.
+ */
+CO_Status BENCH_JobRun(BENCH_Job *job, CO_Slice *slice);
+
+/** \brief Run every backend over all size and loop points of \p config.
+ *
+ * Results are emitted grouped per backend, so each backend produces one
+ * throughput curve over payload size.
+ */
+void BENCH_Sweep(const BENCH_Backend *backends, unsigned count,
+		const BENCH_Clock *clock, const BENCH_SweepConfig *config,
+		BENCH_PrepareFunc prepare, BENCH_EmitFunc emit);
+
+/** \brief Resumable BENCH_Sweep, see BENCH_SweepJobInit. */
+typedef struct {
+	const BENCH_Backend *backends;
+	unsigned count;
+	const BENCH_Clock *clock;
+	const BENCH_SweepConfig *config;
+	BENCH_PrepareFunc prepare;
+	BENCH_EmitFunc emit;
+	unsigned b;                 /**< Backend of the running point */
+	uint32_t size;              /**< Payload size of the running point */
+	uint32_t loops;             /**< Frames of the running point */
+	const char *frame;
+	unsigned len;
+	BENCH_Result result;
+	BENCH_Job run;              /**< Measurement of the running point */
+	CO_State co;
+} BENCH_SweepJob;
+
+/** \brief Prepare \p job for BENCH_SweepJobRun, same arguments as BENCH_Sweep. */
+void BENCH_SweepJobInit(BENCH_SweepJob *job, const BENCH_Backend *backends, unsigned count,
+		const BENCH_Clock *clock, const BENCH_SweepConfig *config,
+		BENCH_PrepareFunc prepare, BENCH_EmitFunc emit);
+
+/** \brief Measure until \p slice is used up or a point has been emitted.
+ *
+ * Every call continues the running point, see BENCH_JobRun. The frame set
+ * by prepare must stay unchanged until the next call.
+ */
+CO_Status BENCH_SweepJobRun(BENCH_SweepJob *job, CO_Slice *slice);
+
+/** \brief Value following \p v in \p range, 0 once the range is done. */
+uint32_t BENCH_RangeNext(const BENCH_Range *range, uint32_t v);
+
+/** \brief Fill in the derived fields of \p result from its ticks and bytes. */
+void BENCH_Compute(const BENCH_Clock *clock, BENCH_Result *result);
+
+/** \brief Format the CSV header line. Returns the line length. */
+int BENCH_FormatHeader(char *buf, unsigned size);
+
+/** \brief Format one CSV result line. Returns the line length. */
+int BENCH_FormatRow(char *buf, unsigned size, const BENCH_Result *result);
+
+#endif /* BENCH_H_ */
@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+//! \file compress.h
+//!
+//! Streaming compression of payload data before it is written to RTT.
+//!
+//! Two byte oriented coders with static state only:
+//!
+//! LZ      LZSS with a COMP_LZ_WINDOW byte window. A flag byte precedes each
+//!         group of up to 8 items, bit i set for a literal byte and clear
+//!         for a match of two bytes: distance - 1, length - 3. Matches are
+//!         3 to 258 bytes long and may reach back into earlier calls.
+//!
+//! RLE     Byte wise delta to the previous byte followed by run-length
+//!         coding of the deltas: a control byte 0..127 is followed by
+//!         control + 1 literal deltas, 128..255 by one delta repeated
+//!         control - 125 times. Slow ramps and constant areas collapse.
+//!
+//! Both keep state across calls, so each call compresses the next piece of
+//! one continuous stream. The decoder must see every piece in order: reset
+//! both sides together (for example at frame sequence 0). On a channel
+//! that can drop data, write each piece whole or not at all and reset the
+//! encoder when a write fails; the receiver resets its decoder where a
+//! piece is missing, e.g. at a frame sequence gap (see Send_Lz in main.c
+//! and Tools/rtt_decompress). A damaged piece cannot be recovered this way.
+//! Each call's output is complete on its own, it can be framed and sent as
+//! one unit.
+//-----------------------------------------------------------------------------
+#ifndef COMPRESS_H_
+#define COMPRESS_H_
+
+#include <stdint.h>
+
+/** \brief LZ history size in bytes, the largest match distance. */
+#define COMP_LZ_WINDOW          256
+
+/** \brief Entries in the LZ match finder hash table, as a power of two. */
+#define COMP_LZ_HASH_BITS       8
+#define COMP_LZ_HASH_SIZE       (1u << COMP_LZ_HASH_BITS)
+
+/** \brief Worst case LZ output for \p len input bytes. */
+#define COMP_LZ_BOUND(len)      ((len) + ((len) + 7) / 8)
+
+/** \brief Worst case RLE output for \p len input bytes. */
+#define COMP_RLE_BOUND(len)     ((len) + ((len) + 127) / 128)
+
+/** \brief LZ encoder state. */
+typedef struct {
+	uint8_t win[COMP_LZ_WINDOW];        /**< Last input bytes, by position */
+	uint32_t head[COMP_LZ_HASH_SIZE];   /**< Last position of each hash */
+	uint32_t pos;                       /**< Stream position of the next byte */
+} COMP_LzEncoder;
+
+/** \brief LZ decoder state. */
+typedef struct {
+	uint8_t win[COMP_LZ_WINDOW];
+	uint32_t pos;
+} COMP_LzDecoder;
+
+/** \brief Delta/RLE state, shared by encoder and decoder. */
+typedef struct {
+	uint8_t prev;                       /**< Last byte of the stream */
+} COMP_RleState;
+
+/** \brief Start a new LZ stream. */
+void COMP_LzEncoderInit(COMP_LzEncoder *s);
+
+/** \brief Compress \p len bytes into \p dst (COMP_LZ_BOUND(len) bytes).
+ * \return Number of bytes written. */
+unsigned COMP_LzEncode(COMP_LzEncoder *s, uint8_t *dst, const uint8_t *src, unsigned len);
+
+/** \brief Start a new LZ stream on the receiving side. */
+void COMP_LzDecoderInit(COMP_LzDecoder *s);
+
+/** \brief Decompress the output of one COMP_LzEncode call.
+ * \return Number of bytes written to \p dst, -1 if the data is invalid or
+ *         does not fit in \p size bytes. */
+int COMP_LzDecode(COMP_LzDecoder *s, uint8_t *dst, unsigned size, const uint8_t *src, unsigned len);
+
+/** \brief Start a new delta/RLE stream, on either side. */
+void COMP_RleInit(COMP_RleState *s);
+
+/** \brief Compress \p len bytes into \p dst (COMP_RLE_BOUND(len) bytes).
+ * \return Number of bytes written. */
+unsigned COMP_RleEncode(COMP_RleState *s, uint8_t *dst, const uint8_t *src, unsigned len);
+
+/** \brief Decompress the output of one COMP_RleEncode call.
+ * \return Number of bytes written to \p dst, -1 if the data is invalid or
+ *         does not fit in \p size bytes. */
+int COMP_RleDecode(COMP_RleState *s, uint8_t *dst, unsigned size, const uint8_t *src, unsigned len);
+
+#endif /* COMPRESS_H_ */
@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------------
+//! \file coroutine.h
+//!
+//! Stackless cooperative coroutines (protothreads) for long running jobs.
+//!
+//! A coroutine is a function that returns CO_YIELDED to give the main loop
+//! a turn and is called again later to continue after the yield point. The
+//! resume point is the source line of the last CO_YIELD, kept in a
+//! CO_State, and the body is a switch statement on it:
+//!
+//!     CO_Status Job(Job_t *j)
+//!     {
+//!         CO_BEGIN(&j->co);
+//!         for (j->i = 0; j->i < 100; j->i++)
+//!         {
+//!             Work(j->i);
+//!             CO_YIELD(&j->co);
+//!         }
+//!         CO_END(&j->co);
+//!     }
+//!
+//! Local variables do not survive a yield, keep loop state in the job
+//! structure. CO_YIELD cannot be used inside another switch statement of
+//! the coroutine, and a coroutine can only yield from its own body; to
+//! wait for a nested coroutine use CO_AWAIT.
+//!
+//! CO_Slice decides when a job has used its turn: after a number of units
+//! of work or a time budget, whichever comes first. Like bench.h the module
+//! only depends on the C library; the clock is passed in.
+//-----------------------------------------------------------------------------
+#ifndef COROUTINE_H_
+#define COROUTINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \brief Result of one call of a coroutine. */
+typedef enum {
+	CO_YIELDED,                 /**< Call again to continue */
+	CO_DONE                     /**< Finished, the state is reset */
+} CO_Status;
+
+/** \brief Resume point of a coroutine, all zero starts from the top. */
+typedef struct {
+	uint16_t line;
+} CO_State;
+
+/** \brief Restart \p co from the top on its next call. */
+#define CO_INIT(co)         ((co)->line = 0)
+
+/** \brief First statement of a coroutine body. */
+#define CO_BEGIN(co)        switch ((co)->line) { case 0:
+
+/** \brief Return to the caller, the next call continues after this point. */
+#define CO_YIELD(co) \
+	do { (co)->line = __LINE__; return CO_YIELDED; case __LINE__:; } while (0)
+
+/** \brief Yield while \p cond is false. */
+#define CO_WAIT_UNTIL(co, cond) \
+	do { (co)->line = __LINE__; case __LINE__: if (!(cond)) return CO_YIELDED; } while (0)
+
+/** \brief Run the coroutine call \p call, yielding each time it yields. */
+#define CO_AWAIT(co, call)  CO_WAIT_UNTIL(co, (call) == CO_DONE)
+
+/** \brief Last statement of a coroutine body. */
+#define CO_END(co)          } (co)->line = 0; return CO_DONE
+
+/** \brief Turn length of a job. */
+typedef struct {
+	uint32_t (*now)(void);      /**< Free running tick counter */
+	uint32_t units;             /**< Units of work per turn, 0: no limit */
+	uint32_t ticks;             /**< Ticks per turn, 0: no limit */
+	uint32_t count;             /**< Units done in this turn */
+	uint32_t start;             /**< now() at the start of this turn */
+} CO_Slice;
+
+/** \brief Set up \p slice to end a turn after \p units units of work or
+ * \p ticks ticks of \p now; both 0 never ends a turn. */
+void CO_SliceInit(CO_Slice *slice, uint32_t (*now)(void), uint32_t units, uint32_t ticks);
+
+/** \brief Start a new turn. */
+void CO_SliceStart(CO_Slice *slice);
+
+/** \brief Count one unit of work.
+ * \return true if the turn is used up and the job should yield. */
+bool CO_SliceUsed(CO_Slice *slice);
+
+#endif /* COROUTINE_H_ */
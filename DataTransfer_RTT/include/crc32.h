@@ -0,0 +1,22 @@
+//-----------------------------------------------------------------------------
+//! \file crc32.h
+//!
+//! CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) using slice-by-4.
+//!
+//! The four 256 entry tables (4 KB) are generated into RAM by
+//! CRC32_Initialize, which avoids flash wait states on every lookup.
+//-----------------------------------------------------------------------------
+#ifndef CRC32_H_
+#define CRC32_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Build the lookup tables. Must be called once before CRC32_Update. */
+void CRC32_Initialize(void);
+
+/** \brief Continue a CRC over \p len bytes. Start with crc = 0; the result of
+ * one call can be passed to the next to checksum data in pieces. */
+uint32_t CRC32_Update(uint32_t crc, const void *data, size_t len);
+
+#endif /* CRC32_H_ */
@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------------
+//! \file dispatch.h
+//!
+//! Priority event dispatcher run next to BDK_Schedule.
+//!
+//! BDK_Schedule calls its handlers in a fixed order with no priorities, so
+//! an urgent event waits behind whatever else is pending. Events posted here
+//! carry one of 32 priorities, 0 is the most urgent. A ready bitmap holds
+//! bit 31 - p for every priority p with pending events, so the next
+//! priority to run is a single CLZ of the bitmap; events of one priority
+//! run in the order they were posted.
+//!
+//! Events live in a static pool of DISP_POOL_SIZE entries chained into one
+//! FIFO list per priority, so post and dispatch are O(1) and no heap is
+//! used. A post to a full pool is dropped and counted.
+//!
+//! DISP_Post may be called from interrupt handlers; it masks interrupts for
+//! the few instructions that link the event. Events run only from
+//! DISP_Dispatch / DISP_Run in the main loop, and every dispatched event
+//! re-reads the bitmap, so an event posted by an interrupt during a batch
+//! runs before lower priority events that were already pending.
+//!
+//! Define HOST_BUILD to build without the CMSIS intrinsics. The host build
+//! is single-threaded: interrupts are modelled by posting from handlers.
+//-----------------------------------------------------------------------------
+#ifndef DISPATCH_H_
+#define DISPATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "latency.h"
+
+/** \brief Number of priorities, one bit of the ready bitmap each. */
+#define DISP_PRIORITY_COUNT     32
+
+/** \brief Events that can be pending at once, at most 255. */
+#ifndef DISP_POOL_SIZE
+#define DISP_POOL_SIZE          32
+#endif
+
+/** \brief Event callback, runs in the main loop. */
+typedef void (*DISP_Handler)(void *arg);
+
+/** \brief Pending event, one pool entry. */
+typedef struct {
+	DISP_Handler handler;
+	void *arg;
+	uint32_t posted;            /**< TIMING_Now() when posted */
+	uint8_t next;               /**< Next entry of the same list */
+} DISP_Event;
+
+/** \brief Dispatcher state. */
+typedef struct {
+	DISP_Event pool[DISP_POOL_SIZE];
+	uint8_t head[DISP_PRIORITY_COUNT];  /**< Oldest event per priority */
+	uint8_t tail[DISP_PRIORITY_COUNT];  /**< Newest event per priority */
+	uint8_t free;                       /**< First unused pool entry */
+	volatile uint32_t ready;            /**< Bit 31 - p: priority p pending */
+	uint32_t dispatched;                /**< Events run */
+	volatile uint32_t dropped;          /**< Posts rejected by a full pool */
+	/** Optional per priority histograms of the time from post to dispatch */
+	LAT_Histogram *wait[DISP_PRIORITY_COUNT];
+} DISP_Dispatcher;
+
+/** \brief Initialize \p d with no pending events and no histograms. */
+void DISP_Init(DISP_Dispatcher *d);
+
+/** \brief Record the post to dispatch time of \p priority into \p wait
+ * (TIMING_Now ticks), NULL to stop recording. */
+void DISP_SetWaitHistogram(DISP_Dispatcher *d, unsigned priority, LAT_Histogram *wait);
+
+/** \brief Queue \p handler(\p arg) at \p priority, interrupt safe.
+ * \return false if the pool is full or the priority is out of range. */
+bool DISP_Post(DISP_Dispatcher *d, unsigned priority, DISP_Handler handler, void *arg);
+
+/** \brief Run the oldest event of the most urgent pending priority.
+ * \return false if nothing was pending. */
+bool DISP_Dispatch(DISP_Dispatcher *d);
+
+/** \brief true if any event is waiting, e.g. for the idle check that
+ * runs with interrupts masked before sleeping. */
+bool DISP_Pending(const DISP_Dispatcher *d);
+
+/** \brief Run pending events until none is left or \p max have run.
+ * \return Number of events run. */
+unsigned DISP_Run(DISP_Dispatcher *d, unsigned max);
+
+#endif /* DISPATCH_H_ */
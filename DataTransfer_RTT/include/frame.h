@@ -0,0 +1,29 @@
+//-----------------------------------------------------------------------------
+//! \file frame.h
+//!
+//! Optional framing of streamed hex frames with a sequence number and CRC.
+//!
+//! Framed line layout, all numbers in uppercase hex, most significant first:
+//!
+//!     F<seq:8>:<payload:2*len>:<crc:8>\n
+//!
+//! The CRC-32 covers the sequence number (4 bytes, little endian) followed
+//! by the raw payload bytes. A receiver can detect lost frames from gaps in
+//! the sequence and damaged ones from the CRC. CRC32_Initialize must have
+//! been called before FRAME_Encode is used.
+//-----------------------------------------------------------------------------
+#ifndef FRAME_H_
+#define FRAME_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Characters produced by FRAME_Encode for \p len payload bytes,
+ * including the line feed. */
+#define FRAME_ENCODED_SIZE(len)    (2 * (len) + 20)
+
+/** \brief Write the framed line for \p payload into \p dst.
+ * \return Number of characters written (no terminator is added). */
+unsigned FRAME_Encode(char *dst, uint32_t seq, const uint8_t *payload, size_t len);
+
+#endif /* FRAME_H_ */
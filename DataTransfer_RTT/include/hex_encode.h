@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+//! \file hex_encode.h
+//!
+//! Byte to ASCII hex encoders used by the RTT data transfer benchmark.
+//!
+//! All encoders write 2 characters per input byte straight into a caller
+//! provided buffer and do not append a terminator. The module only depends
+//! on the C standard library so it builds for the RSL10 as well as for a
+//! Linux host.
+//-----------------------------------------------------------------------------
+#ifndef HEX_ENCODE_H_
+#define HEX_ENCODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Number of characters produced for \p len input bytes. */
+#define HEX_ENCODED_SIZE(len)    (2 * (len))
+
+/** \brief Letter case used for the digits A-F. */
+typedef enum {
+	HEX_UPPER = 0,
+	HEX_LOWER = 1
+} HEX_Case;
+
+/** \brief Table driven encoder (uppercase).
+ *
+ * Uses a 512 byte byte-to-two-chars lookup table and processes 4 input
+ * bytes per iteration.
+ *
+ * \param dst Output buffer, at least HEX_ENCODED_SIZE(len) characters.
+ * \param src Input bytes.
+ * \param len Number of input bytes.
+ * \return Pointer one past the last character written.
+ */
+char *HEX_Encode(char *dst, const uint8_t *src, size_t len);
+
+/** \brief SIMD-within-a-register encoder.
+ *
+ * Converts 4 input bytes into 8 characters in 32-bit registers using only
+ * add, mask and shift, so there are no table reads hitting flash wait
+ * states.
+ *
+ * \param dst Output buffer, at least HEX_ENCODED_SIZE(len) characters.
+ * \param src Input bytes.
+ * \param len Number of input bytes.
+ * \param letter_case HEX_UPPER or HEX_LOWER.
+ * \return Pointer one past the last character written.
+ */
+char *HEX_EncodeSwar(char *dst, const uint8_t *src, size_t len, HEX_Case letter_case);
+
+/** \brief Original per-nibble compare-and-branch encoder (uppercase).
+ *
+ * Kept as reference implementation and benchmark baseline.
+ */
+char *HEX_EncodeNibble(char *dst, const uint8_t *src, size_t len);
+
+#endif /* HEX_ENCODE_H_ */
@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------------
+//! \file idle.h
+//!
+//! Tickless idle: sleep until the next software timer deadline.
+//!
+//! The main loop used to end with SYS_WAIT_FOR_INTERRUPT and be woken by
+//! whatever interrupt came next, including periodic timer ticks with nothing
+//! due. The idle manager keeps the application timers itself in a timing
+//! wheel (wheel.h). IDLE_Sleep programs a single one-shot wakeup for the
+//! earliest expiry, or none if no timer is armed, and then waits for an
+//! interrupt. The wheel moves timers down its levels in IDLE_RunExpired
+//! after the wakeup rather than waking up for each move. Expired timers
+//! run from IDLE_RunExpired in the main loop, like callbacks attached with
+//! SwTimer_AttachScheduled, in deadline order and in start order for equal
+//! deadlines.
+//!
+//! Going to sleep races with interrupts: an event posted after the main
+//! loop last looked at its queues but before the WFI would wait for the
+//! next interrupt. The port's sleep() therefore masks interrupts, asks the
+//! pending predicate set with IDLE_SetPending, and executes WFI only if
+//! nothing is pending. WFI wakes on an interrupt that is pending while
+//! masked, and the handler runs once sleep() unmasks, so nothing posted
+//! after the check can be slept through. A wakeup deadline that has passed
+//! by then counts as pending as well. A skipped sleep is counted in
+//! \c skipped and not as a sleep.
+//!
+//! Deadlines are in ticks of the port's now(), compared modulo 2^32, so a
+//! delay must stay below 2^31 ticks. The time between IDLE_Sleep calls is
+//! counted as awake, the time inside the port's sleep() as asleep.
+//!
+//! IDLE_DevicePort wakes the core with a one-shot of TIMER2 clocked from
+//! SLOWCLK / 2 (2 us per count, at most 2^24 counts), next to TIMER1 that
+//! RTE_SW_TIMER_INSTANCE gives the BDK software timers. Its clock is
+//! TIMING_Now, which stops in WFI if the sleep gates the core clock; after
+//! each sleep the port moves its clock forward to at least the time TIMER2
+//! has counted, so expiries are not delayed by the time slept. Define
+//! HOST_BUILD to leave the device port out.
+//-----------------------------------------------------------------------------
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "wheel.h"
+
+/** \brief Timer callback, runs in the main loop. */
+typedef WHEEL_Callback IDLE_Callback;
+
+/** \brief Application timer, one-shot. */
+typedef WHEEL_Timer IDLE_Timer;
+
+/** \brief Work check, called with interrupts masked.
+ * \return true if the main loop has work and must not sleep. */
+typedef bool (*IDLE_PendingFunc)(void *arg);
+
+/** \brief Clock, wakeup timer and sleep of the platform. */
+typedef struct {
+	uint32_t (*now)(void);                  /**< Free running tick counter */
+	void (*set_wakeup)(uint32_t ticks);     /**< Interrupt after ticks, 0 cancels */
+	/** Mask interrupts, wait for one unless pending(arg), unmask.
+	 * Returns false if it did not wait. */
+	bool (*sleep)(IDLE_PendingFunc pending, void *arg);
+	uint32_t max_wakeup;                    /**< Longest set_wakeup in ticks */
+} IDLE_Port;
+
+/** \brief Idle manager state. */
+typedef struct {
+	const IDLE_Port *port;
+	WHEEL_Wheel wheel;          /**< Armed timers, ticks of port->now */
+	IDLE_PendingFunc pending;   /**< Work check before sleeping, may be NULL */
+	void *pending_arg;
+	uint32_t last;              /**< now() when the last sleep ended */
+	uint32_t wake_at;           /**< now() of the programmed wakeup */
+	bool wake_armed;            /**< wake_at is valid */
+	uint64_t awake_ticks;
+	uint64_t asleep_ticks;
+	uint32_t sleeps;            /**< Calls of port->sleep */
+	uint32_t wakeups_set;       /**< Sleeps with a one-shot wakeup programmed */
+	uint32_t expired;           /**< Timer callbacks run */
+	uint32_t skipped;           /**< Sleeps not taken, work was pending */
+} IDLE_Manager;
+
+/** \brief Line length sufficient for IDLE_FormatStats. */
+#define IDLE_LINE_SIZE      112
+
+#ifndef HOST_BUILD
+/** \brief TIMER2 one-shot and WFI with TIMING_Now, corrected by the TIMER2
+ * count across sleeps, as the clock. Call IDLE_DeviceInitialize after
+ * TIMING_Initialize before using it. */
+extern IDLE_Port IDLE_DevicePort;
+
+/** \brief Set up TIMER2 and the limits of IDLE_DevicePort. */
+void IDLE_DeviceInitialize(void);
+#endif
+
+/** \brief Initialize \p m with no armed timers and zero statistics. */
+void IDLE_Init(IDLE_Manager *m, const IDLE_Port *port);
+
+/** \brief Make IDLE_Sleep call \p pending(\p arg) with interrupts masked
+ * and stay awake while it returns true, NULL to remove the check. */
+void IDLE_SetPending(IDLE_Manager *m, IDLE_PendingFunc pending, void *arg);
+
+/** \brief Prepare \p t to call \p callback(\p arg) when it expires. */
+void IDLE_TimerInit(IDLE_Timer *t, IDLE_Callback callback, void *arg);
+
+/** \brief Arm \p t to expire \p delay ticks from now, rearming if armed. */
+void IDLE_TimerStart(IDLE_Manager *m, IDLE_Timer *t, uint32_t delay);
+
+/** \brief Disarm \p t, nothing happens if it is not armed. */
+void IDLE_TimerStop(IDLE_Manager *m, IDLE_Timer *t);
+
+/** \brief Ticks from \p now to the earliest deadline, 0 if it has passed.
+ * \return false if no timer is armed. */
+bool IDLE_NextDeadline(const IDLE_Manager *m, uint32_t now, uint32_t *delay);
+
+/** \brief Run the callbacks of all expired timers, main loop only.
+ * \return Number of callbacks run. */
+unsigned IDLE_RunExpired(IDLE_Manager *m);
+
+/** \brief Sleep until the next deadline or any other interrupt.
+ *
+ * Returns at once if a timer has already expired, or without sleeping if
+ * the pending check finds work once interrupts are masked. A deadline
+ * further away than port->max_wakeup is reached over several sleeps.
+ */
+void IDLE_Sleep(IDLE_Manager *m);
+
+/** \brief Format "idle,awake_us,asleep_us,asleep_permille,sleeps,wakeups_set,expired,skipped".
+ * \return The line length. */
+int IDLE_FormatStats(char *buf, unsigned size, const IDLE_Manager *m, uint32_t tick_hz);
+
+#endif /* IDLE_H_ */
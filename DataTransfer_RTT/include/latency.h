@@ -0,0 +1,65 @@
+//-----------------------------------------------------------------------------
+//! \file latency.h
+//!
+//! Per-call latency recorder with a log-scaled histogram.
+//!
+//! Each power of two is split into 4 buckets, so a bucket spans at most 25%
+//! of its lower bound and percentiles are reported with that precision.
+//! Values below 8 ticks have their own bucket. The histogram is a fixed
+//! 124 entry array (about 0.5 KB), no heap is used.
+//-----------------------------------------------------------------------------
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+/** \brief Number of histogram buckets covering the full 32-bit range. */
+#define LAT_BUCKET_COUNT    124
+
+/** \brief Line length sufficient for the LAT_Format functions. */
+#define LAT_LINE_SIZE       128
+
+/** \brief Latency statistics in ticks of the recording time source. */
+typedef struct {
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t bucket[LAT_BUCKET_COUNT];
+} LAT_Histogram;
+
+/** \brief Clear all statistics. */
+void LAT_Reset(LAT_Histogram *h);
+
+/** \brief Add one latency sample. */
+void LAT_Record(LAT_Histogram *h, uint32_t ticks);
+
+/** \brief Histogram bucket holding \p ticks. */
+unsigned LAT_BucketIndex(uint32_t ticks);
+
+/** \brief Smallest value falling into bucket \p index. */
+uint32_t LAT_BucketLow(unsigned index);
+
+/** \brief Largest value falling into bucket \p index. */
+uint32_t LAT_BucketHigh(unsigned index);
+
+/** \brief Upper bound of the value below which \p permille of the samples
+ * fall, clamped to the recorded min/max. 0 if nothing was recorded. */
+uint32_t LAT_Percentile(const LAT_Histogram *h, unsigned permille);
+
+/** \brief Largest time printed by the LAT_Format functions, in ns.
+ * Longer times (from about 4.29 s) are printed as this value. */
+#define LAT_NS_MAX          0xffffffffu
+
+/** \brief Format "lat,name,count,min,p50,p99,max,mean" in nanoseconds,
+ * capped at LAT_NS_MAX. Returns the line length. */
+int LAT_FormatSummary(char *buf, unsigned size, const char *name,
+		const LAT_Histogram *h, uint32_t tick_hz);
+
+/** \brief Format "hist,name,low,high,count" in nanoseconds for bucket
+ * \p index, capped at LAT_NS_MAX. Returns the line length, 0 for empty
+ * buckets. */
+int LAT_FormatBucket(char *buf, unsigned size, const char *name,
+		const LAT_Histogram *h, unsigned index, uint32_t tick_hz);
+
+#endif /* LATENCY_H_ */
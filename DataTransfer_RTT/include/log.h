@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+//! \file log.h
+//!
+//! Tokenized logger with deferred formatting.
+//!
+//! LOG("fmt", args...) writes a binary record to RTT up-buffer
+//! LOG_RTT_CHANNEL instead of formatting text on the device:
+//!
+//!     word 0      token: (number of args << 24) | offset of the format
+//!                 string in the rtt_log_fmt ELF section
+//!     word 1..n   arguments, each cast to 32 bits
+//!
+//! The format strings are placed in the non-allocated rtt_log_fmt section
+//! (see sections.ld), so they stay in the ELF file for the host decoder
+//! (Tools/log_decode) but take no flash. Supported conversions are the
+//! integer ones (d i u x X o c p) and %s; a %s argument must point to a
+//! constant string in the ELF image since only its address is sent.
+//! At most LOG_MAX_ARGS arguments can be passed.
+//!
+//! Nothing is parsed at runtime. At compile time the arguments are checked
+//! against the format by GCC's printf format checking (an unreachable call
+//! to a format(printf) function, mismatches are turned into errors) and
+//! each argument is classified with C11 _Generic: integers and pointers are
+//! packed as one word; long long, floating point and, where long is wider
+//! than 32 bits (LP64 host builds), long values are rejected since they do
+//! not fit the 32-bit record slot. Pointers are cut to 32 bits on such
+//! hosts, link host tests with -no-pie.
+//!
+//! Records are written with a single SEGGER_RTT_Write, so a full ring drops
+//! a whole record and never leaves a partial one in the stream.
+//!
+//! DataTransfer_RTT and Base_Project each build their own copy of log.h and
+//! log.c; the two copies must stay identical.
+//-----------------------------------------------------------------------------
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <stdint.h>
+
+/** \brief RTT up-buffer used for log records. */
+#ifndef LOG_RTT_CHANNEL
+#define LOG_RTT_CHANNEL     1
+#endif
+
+/** \brief Size of the RTT up-buffer used for log records. */
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE     512
+#endif
+
+/** \brief Maximum number of arguments per record. */
+#define LOG_MAX_ARGS        8
+
+/** \brief Start of the format string section, provided by the linker. */
+extern const char __start_rtt_log_fmt[];
+
+/** \brief Configure the RTT up-buffer for log records. */
+void LOG_Initialize(void);
+
+/** \brief Write one record of \p count words. */
+void LOG_Write(const uint32_t *words, unsigned count);
+
+/** \brief Never called, only carries the printf format check for LOG. */
+static inline void LOG_FormatCheck(const char *fmt, ...)
+	__attribute__((format(printf, 1, 2)));
+static inline void LOG_FormatCheck(const char *fmt, ...)
+{
+	(void)fmt;
+}
+
+/** \brief Never defined, selecting it makes the build fail with a message. */
+extern uint32_t LOG_UnsupportedArgument(void)
+	__attribute__((error("LOG: 64-bit and floating point arguments do not fit a 32-bit record slot")));
+
+/* long is 64 bits on LP64 hosts and would be truncated silently */
+#if __SIZEOF_LONG__ > 4
+#define LOG_ARG_LONG \
+		long: LOG_UnsupportedArgument(), \
+		unsigned long: LOG_UnsupportedArgument(),
+#else
+#define LOG_ARG_LONG
+#endif
+
+/** \brief Log a message, see the file description. */
+#define LOG(fmt, ...) \
+	do { \
+		_Pragma("GCC diagnostic push") \
+		_Pragma("GCC diagnostic error \"-Wformat\"") \
+		if (0) \
+		{ \
+			LOG_FormatCheck(fmt, ##__VA_ARGS__); \
+		} \
+		_Pragma("GCC diagnostic pop") \
+		static const char log_fmt_[] \
+			__attribute__((section("rtt_log_fmt"), used)) = fmt; \
+		const uint32_t log_rec_[] = { \
+			LOG_TOKEN(log_fmt_, LOG_NARGS(__VA_ARGS__)) \
+			LOG_CAT(LOG_MAP_, LOG_NARGS(__VA_ARGS__))(__VA_ARGS__) \
+		}; \
+		LOG_Write(log_rec_, sizeof(log_rec_) / sizeof(log_rec_[0])); \
+	} while (0)
+
+/* Helpers used by LOG */
+#define LOG_TOKEN(fmt, n) \
+	(((uint32_t)(n) << 24) | \
+	 (uint32_t)((uintptr_t)(fmt) - (uintptr_t)__start_rtt_log_fmt))
+
+/* Integers and pointers take the default branch; the other branches are
+ * never evaluated unless selected. */
+#define LOG_ARG(x) \
+	_Generic((x), \
+		LOG_ARG_LONG \
+		long long: LOG_UnsupportedArgument(), \
+		unsigned long long: LOG_UnsupportedArgument(), \
+		float: LOG_UnsupportedArgument(), \
+		double: LOG_UnsupportedArgument(), \
+		long double: LOG_UnsupportedArgument(), \
+		default: (uint32_t)(uintptr_t)(x))
+
+#define LOG_CAT(a, b)       LOG_CAT_(a, b)
+#define LOG_CAT_(a, b)      a##b
+
+#define LOG_NARGS(...)      LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...)  n
+
+#define LOG_MAP_0()
+#define LOG_MAP_1(a)                        , LOG_ARG(a)
+#define LOG_MAP_2(a, b)                     LOG_MAP_1(a) LOG_MAP_1(b)
+#define LOG_MAP_3(a, b, c)                  LOG_MAP_2(a, b) LOG_MAP_1(c)
+#define LOG_MAP_4(a, b, c, d)               LOG_MAP_3(a, b, c) LOG_MAP_1(d)
+#define LOG_MAP_5(a, b, c, d, e)            LOG_MAP_4(a, b, c, d) LOG_MAP_1(e)
+#define LOG_MAP_6(a, b, c, d, e, f)         LOG_MAP_5(a, b, c, d, e) LOG_MAP_1(f)
+#define LOG_MAP_7(a, b, c, d, e, f, g)      LOG_MAP_6(a, b, c, d, e, f) LOG_MAP_1(g)
+#define LOG_MAP_8(a, b, c, d, e, f, g, h)   LOG_MAP_7(a, b, c, d, e, f, g) LOG_MAP_1(h)
+
+#endif /* LOG_H_ */
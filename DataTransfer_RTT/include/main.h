@@ -17,4 +17,10 @@
 /** \brief Application callback for handling of Push Button events. */
 void PB_TransitionEvent(void *arg);
 
+/** \brief Push Button press handler, runs in interrupt context. */
+void PB_PressedInt(void *arg);
+
+/** \brief Push Button release handler, runs in interrupt context. */
+void PB_ReleasedInt(void *arg);
+
 #endif /* MAIN_H_ */
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+//! \file pipeline.h
+//!
+//! Double-buffered (ping-pong) producer for RTT output.
+//!
+//! The serial path generates and encodes a frame, then waits until all of
+//! it is in the RTT ring before starting on the next one. Whenever the host
+//! is slower than the target the core spins in that wait.
+//!
+//! The pipeline keeps two frame buffers. Each PIPE_Poll writes whatever
+//! fits of the frame in flight without waiting and, if the other buffer is
+//! free, produces the next frame into it. So frame N+1 is encoded while the
+//! host is still reading frame N out of the ring.
+//!
+//! A buffer signals completion by returning to the free state. PIPE_Poll is
+//! called once per pass of the main loop after BDK_Schedule, so the other
+//! scheduled events keep running between the pipeline steps. PIPE_PollSerial
+//! is the serial path in the same form, so both can be timed in the same
+//! loop.
+//!
+//! Like RTT_POLICY_BLOCK_TIMEOUT of rtt_channel.h, a frame that makes no
+//! progress for the timeout set with PIPE_SetTimeout is dropped and counted
+//! instead of being waited for forever. When part of the frame was already
+//! written, a newline ends its line before the next frame, so the host sees
+//! one truncated frame.
+//!
+//! The frames are written with RTT_Reserve/RTT_Commit, so the pipeline must
+//! be the only writer of its channel while it is busy.
+//-----------------------------------------------------------------------------
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \brief Produce the next frame into \p buf.
+ * \return Frame length, 0 when there are no more frames. */
+typedef unsigned (*PIPE_ProduceFunc)(char *buf, void *arg);
+
+/** \brief Pipeline state. */
+typedef struct {
+	char *buf[2];               /**< Frame buffers */
+	unsigned len[2];            /**< Frame length per buffer, 0 when free */
+	unsigned fill;              /**< Buffer the producer fills next */
+	unsigned drain;             /**< Buffer being written to RTT */
+	unsigned sent;              /**< Bytes of buf[drain] already written */
+	unsigned channel;           /**< RTT up-buffer index */
+	PIPE_ProduceFunc produce;
+	void *arg;                  /**< Passed to produce */
+	bool done;                  /**< produce has returned 0 */
+	bool cut;                   /**< A partly written frame was dropped, newline owed */
+	uint32_t (*now)(void);      /**< Tick source of the timeout, NULL waits forever */
+	uint32_t timeout_ticks;     /**< Longest stall before a frame is dropped */
+	uint32_t stall_start;       /**< Tick of the first poll without progress */
+	bool stalled;               /**< stall_start is valid */
+	uint32_t frames;            /**< Frames completely written */
+	uint32_t bytes;             /**< Bytes written */
+	uint32_t full_polls;        /**< Polls that found the ring full */
+	uint32_t dropped;           /**< Frames dropped after the timeout */
+	uint32_t dropped_bytes;     /**< Unwritten bytes of the dropped frames */
+} PIPE_Pipeline;
+
+/** \brief Initialize \p p to write frames from \p produce to \p channel.
+ * Both buffers must hold the largest frame produce can return. */
+void PIPE_Init(PIPE_Pipeline *p, unsigned channel, char *buf0, char *buf1,
+		PIPE_ProduceFunc produce, void *arg);
+
+/** \brief Drop a frame once the ring has been full for \p timeout_ticks
+ * ticks of \p now. */
+void PIPE_SetTimeout(PIPE_Pipeline *p, uint32_t (*now)(void), uint32_t timeout_ticks);
+
+/** \brief Reset the buffers and counters before a run. */
+void PIPE_Start(PIPE_Pipeline *p);
+
+/** \brief Run one pipeline step without waiting.
+ * \return true while frames remain to be produced or written. */
+bool PIPE_Poll(PIPE_Pipeline *p);
+
+/** \brief Run one step of the serial reference without waiting: the next
+ * frame is only produced once the previous one is completely written or
+ * dropped. Uses buf[0] only.
+ * \return true while frames remain to be produced or written. */
+bool PIPE_PollSerial(PIPE_Pipeline *p);
+
+/** \brief Serial reference in one call: PIPE_Start, then PIPE_PollSerial
+ * until the run is complete. */
+void PIPE_RunSerial(PIPE_Pipeline *p);
+
+#endif /* PIPELINE_H_ */
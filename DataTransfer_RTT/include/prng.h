@@ -0,0 +1,44 @@
+//-----------------------------------------------------------------------------
+//! \file prng.h
+//!
+//! Seeded xorshift32 generator for benchmark payloads.
+//!
+//! The output is fully determined by the seed so the host can regenerate
+//! the exact payload stream: PRNG_Fill stores one 32-bit value per 4 bytes
+//! in little endian order and always consumes ceil(len / 4) values, the
+//! unused bytes of the last value are discarded.
+//-----------------------------------------------------------------------------
+#ifndef PRNG_H_
+#define PRNG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Generator state, each instance is independent and reentrant. */
+typedef struct {
+	uint32_t state;
+} PRNG_State;
+
+/** \brief Seed the generator. xorshift cannot leave the all zero state, a
+ * seed of 0 is therefore replaced by PRNG_ZERO_SEED. */
+void PRNG_Seed(PRNG_State *s, uint32_t seed);
+
+/** \brief Seed used in place of 0. */
+#define PRNG_ZERO_SEED    0x9E3779B9u
+
+/** \brief Next 32-bit value (xorshift32, shifts 13/17/5). */
+static inline uint32_t PRNG_Next(PRNG_State *s)
+{
+	uint32_t x = s->state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	s->state = x;
+	return x;
+}
+
+/** \brief Fill \p len bytes of \p buf, 32 bits at a time. */
+void PRNG_Fill(PRNG_State *s, uint8_t *buf, size_t len);
+
+#endif /* PRNG_H_ */
@@ -0,0 +1,141 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_channel.h
+//!
+//! RTT up-buffer allocation and routing of the output streams.
+//!
+//! Each kind of output gets its own up-buffer so that a flood of bulk data
+//! never delays or blocks a diagnostic message:
+//!
+//!     RTT_CH_TERMINAL  0  human readable text (printf redirection)
+//!     RTT_CH_LOG       1  tokenized binary log records (log.h)
+//!     RTT_CH_BULK      2  benchmark payload frames
+//!     RTT_CH_METRICS   3  benchmark results (CSV)
+//!
+//! Sizes and full-buffer policies are set in the table in rtt_channel.c.
+//! The project defines SEGGER_RTT_MAX_NUM_UP_BUFFERS=4 for the extra
+//! channels.
+//!
+//! RTT_ChannelWrite applies the channel policy when the host stops polling
+//! and the ring fills up. SKIP, TRIM and BLOCK are SEGGER's own modes; the
+//! other policies are implemented here on top of a non-blocking channel:
+//!
+//!     BLOCK_TIMEOUT  wait for the host up to the channel timeout, then
+//!                    drop the write
+//!     DROP_OLDEST    discard the oldest unread bytes to make room. The
+//!                    target moves RdOff itself, so a host that resumes in
+//!                    the middle of the discard can read one torn region
+//!                    (framed output detects it)
+//!     SUMMARY        drop writes while the ring is full and count them;
+//!                    once there is room again a "rtt,degraded,<writes>,
+//!                    <bytes>" line is written before the next data
+//!
+//! Every RTT_ChannelWrite updates the channel counters: bytes written,
+//! bytes dropped, number of writes that found the ring full and the time
+//! spent waiting for the host.
+//!
+//! RTT_BUFFER_RAM selects where the bulk and metrics buffers go. The DSP
+//! and baseband RAM are unused by this project, so large buffers there do
+//! not take space from the data and stack in DRAM. The control block stays
+//! in DRAM where the J-Link finds it. DRAM_BB is only free while the BLE
+//! stack is not used.
+//-----------------------------------------------------------------------------
+#ifndef RTT_CHANNEL_H_
+#define RTT_CHANNEL_H_
+
+#include <stdint.h>
+#include "log.h"
+
+#define RTT_CH_TERMINAL     0
+#define RTT_CH_LOG          LOG_RTT_CHANNEL
+#define RTT_CH_BULK         2
+#define RTT_CH_METRICS      3
+#define RTT_CH_COUNT        4
+
+/* Values of RTT_BUFFER_RAM */
+#define RTT_RAM_DRAM        0   /**< .bss in DRAM */
+#define RTT_RAM_DSP         1   /**< .dram_dsp section in DRAM_DSP (40 KB) */
+#define RTT_RAM_BB          2   /**< .dram_bb section in DRAM_BB (16 KB) */
+
+#ifndef RTT_BUFFER_RAM
+#define RTT_BUFFER_RAM      RTT_RAM_DRAM
+#endif
+
+/** \brief Size of the bulk up-buffer, by default as large as the RAM allows. */
+#ifndef RTT_BULK_BUFFER_SIZE
+#if RTT_BUFFER_RAM == RTT_RAM_DSP
+#define RTT_BULK_BUFFER_SIZE    (32 * 1024)
+#elif RTT_BUFFER_RAM == RTT_RAM_BB
+#define RTT_BULK_BUFFER_SIZE    (8 * 1024)
+#else
+#define RTT_BULK_BUFFER_SIZE    4096
+#endif
+#endif
+
+/** \brief Behaviour of a channel when its ring is full. */
+typedef enum {
+	RTT_POLICY_SKIP,            /**< Drop the whole new write */
+	RTT_POLICY_TRIM,            /**< Write what fits, drop the rest */
+	RTT_POLICY_BLOCK,           /**< Wait until the host made room */
+	RTT_POLICY_BLOCK_TIMEOUT,   /**< Wait up to the channel timeout, then skip */
+	RTT_POLICY_DROP_OLDEST,     /**< Discard unread data to make room */
+	RTT_POLICY_SUMMARY          /**< Skip and report a drop summary later */
+} RTT_Policy;
+
+/** \brief Output counters of one channel, see RTT_ChannelWrite. */
+typedef struct {
+	uint32_t written;       /**< Bytes written to the ring */
+	uint32_t dropped;       /**< Bytes lost, new or (DROP_OLDEST) old */
+	uint32_t stalls;        /**< Writes that found the ring full */
+	uint32_t stall_ticks;   /**< TIMING ticks spent waiting for the host */
+} RTT_ChannelStats;
+
+/** \brief Configuration of one up-buffer. */
+typedef struct {
+	unsigned index;
+	const char *name;
+	char *buffer;       /**< NULL keeps the buffer already assigned by SEGGER */
+	unsigned size;
+	RTT_Policy policy;
+	uint32_t timeout_us;    /**< Wait limit of RTT_POLICY_BLOCK_TIMEOUT */
+} RTT_ChannelConfig;
+
+/** \brief Configure all channels except RTT_CH_LOG, which is owned by
+ * LOG_Initialize. */
+void RTT_ChannelInitialize(void);
+
+/** \brief Change the full-buffer policy of \p channel at runtime. */
+void RTT_ChannelSetPolicy(unsigned channel, RTT_Policy policy);
+
+/** \brief Change the wait limit of RTT_POLICY_BLOCK_TIMEOUT on \p channel. */
+void RTT_ChannelSetTimeout(unsigned channel, uint32_t timeout_us);
+
+/** \brief Size of the buffer assigned to \p channel by the table, 0 for
+ * channels that keep the SEGGER buffer. */
+unsigned RTT_ChannelCapacity(unsigned channel);
+
+/** \brief Use only the first \p size bytes of the buffer of \p channel.
+ *
+ * The ring is reconfigured once the host has read everything in it, which
+ * is waited for up to one second.
+ * \return Size now in use, 0 if the channel could not be resized.
+ */
+unsigned RTT_ChannelResize(unsigned channel, unsigned size);
+
+/** \brief Write \p len bytes to \p channel under its policy, same signature
+ * as SEGGER_RTT_Write.
+ * \return Number of bytes of \p data written. */
+unsigned RTT_ChannelWrite(unsigned channel, const void *data, unsigned len);
+
+/** \brief Counters of \p channel since the last RTT_ChannelResetStats. */
+const RTT_ChannelStats *RTT_ChannelGetStats(unsigned channel);
+
+/** \brief Clear the counters of \p channel. */
+void RTT_ChannelResetStats(unsigned channel);
+
+/** \brief Format channel counters as a CSV line:
+ * "rtt,<name>,<written>,<dropped>,<stalls>,<stall_us>".
+ * \return Length of the line as snprintf. */
+int RTT_ChannelFormatStats(char *buf, unsigned size, const char *name,
+		const RTT_ChannelStats *s);
+
+#endif /* RTT_CHANNEL_H_ */
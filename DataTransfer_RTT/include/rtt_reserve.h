@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_reserve.h
+//!
+//! Zero-copy reserve/commit access to SEGGER RTT up-buffers.
+//!
+//! A producer reserves free space in the ring, writes into it directly and
+//! then publishes everything with a single write index update. Because the
+//! ring can wrap, a reservation is returned as at most two spans.
+//!
+//! Between RTT_Reserve and RTT_Commit the caller owns the channel: no other
+//! write to the same up-buffer may happen in between.
+//!
+//! Define HOST_BUILD to compile against a local stand-in of the SEGGER
+//! up-buffer descriptor so the wrap-around logic can run on a Linux host.
+//-----------------------------------------------------------------------------
+#ifndef RTT_RESERVE_H_
+#define RTT_RESERVE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef HOST_BUILD
+/** \brief Host stand-in with the same layout as SEGGER_RTT_BUFFER_UP. */
+typedef struct {
+	const char *sName;
+	char *pBuffer;
+	unsigned SizeOfBuffer;
+	unsigned WrOff;
+	volatile unsigned RdOff;
+	unsigned Flags;
+} RTT_UpBuffer;
+#else
+#include "SEGGER_RTT.h"
+typedef SEGGER_RTT_BUFFER_UP RTT_UpBuffer;
+#endif
+
+/** \brief Writable area of a reservation, split at the ring wrap point. */
+typedef struct {
+	char *ptr[2];
+	unsigned len[2];
+} RTT_Span;
+
+/** \brief Reserve up to \p len bytes of free space in \p up.
+ *
+ * \param up Up-buffer descriptor.
+ * \param len Requested number of bytes.
+ * \param span Filled with the writable area; len[1] is 0 if no wrap.
+ * \return Number of bytes reserved (span.len[0] + span.len[1]), which is
+ *         less than \p len when the ring does not have enough free space.
+ */
+unsigned RTT_ReserveBuffer(RTT_UpBuffer *up, unsigned len, RTT_Span *span);
+
+/** \brief true if a reservation of \p len bytes can ever be complete.
+ *
+ * One byte of the ring always stays free, so at most SizeOfBuffer - 1
+ * bytes fit even when the ring is empty; waiting for a larger one would
+ * never end.
+ */
+bool RTT_ReserveFits(const RTT_UpBuffer *up, unsigned len);
+
+/** \brief Publish \p len bytes written into a previous reservation. */
+void RTT_CommitBuffer(RTT_UpBuffer *up, unsigned len);
+
+/** \brief Copy \p len bytes into a reservation at offset \p pos, following
+ * the wrap into the second span. */
+void RTT_SpanWrite(const RTT_Span *span, unsigned pos, const void *data, unsigned len);
+
+/** \brief Hex encode \p len bytes (uppercase) into a reservation at offset
+ * \p pos, 2 * \p len characters, including a byte whose two characters
+ * straddle the wrap. */
+void RTT_SpanWriteHex(const RTT_Span *span, unsigned pos, const uint8_t *data, unsigned len);
+
+#ifndef HOST_BUILD
+/** \brief RTT_ReserveBuffer on up-buffer \p channel of the RTT control block. */
+unsigned RTT_Reserve(unsigned channel, unsigned len, RTT_Span *span);
+
+/** \brief RTT_CommitBuffer on up-buffer \p channel of the RTT control block. */
+void RTT_Commit(unsigned channel, unsigned len);
+#endif
+
+#endif /* RTT_RESERVE_H_ */
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_staging.h
+//!
+//! Lock-free multi-producer, single-consumer staging ring for RTT output.
+//!
+//! Interrupt handlers and scheduled callbacks do not write to RTT directly,
+//! which would take SEGGER's interrupt lock for the whole copy. Instead they
+//! reserve a record in the staging ring, copy into it and commit it. The
+//! main loop is the only consumer and drains committed records to RTT.
+//!
+//! Reservation moves the head index with LDREX/STREX, so a producer that is
+//! interrupted by another producer simply retries; interrupts are never
+//! disabled. Records are committed independently and drained in reservation
+//! order: a record that is reserved but not yet committed holds back the
+//! records behind it until its producer commits.
+//!
+//! Each record is a header word followed by the payload, padded to a whole
+//! word. A record never wraps; when it does not fit before the end of the
+//! ring a padding record fills the rest and the record starts at offset 0.
+//! A full ring drops the new record and counts it in \c dropped.
+//!
+//! Define HOST_BUILD to use GCC atomics instead of the CMSIS exclusive
+//! access intrinsics so the ring can be exercised with threads on a host.
+//-----------------------------------------------------------------------------
+#ifndef RTT_STAGING_H_
+#define RTT_STAGING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "rtt_stream.h"
+
+/** \brief Largest payload of a single record. */
+#define RTT_STAGING_MAX_RECORD   0xffff
+
+/** \brief Ring space used by a record with \p len payload bytes. */
+#define RTT_STAGING_RECORD_SIZE(len)   (4 + (((len) + 3) & ~3u))
+
+/** \brief Staging ring state. */
+typedef struct {
+	uint32_t *buf;              /**< Ring storage, all zero when empty */
+	uint32_t size;              /**< Size in bytes, a power of two */
+	volatile uint32_t head;     /**< Reservation index, free running */
+	volatile uint32_t tail;     /**< Drain index, free running */
+	uint32_t seen;              /**< head when the last drain started */
+	uint32_t sent;              /**< Bytes of the record at tail already written */
+	uint32_t written;           /**< Bytes accepted by the drain backend */
+	volatile uint32_t dropped;  /**< Bytes of records rejected by a full ring */
+} RTT_Staging;
+
+/** \brief Initialize \p ring over \p buf of \p size bytes (power of two). */
+void RTT_StagingInit(RTT_Staging *ring, uint32_t *buf, uint32_t size);
+
+/** \brief Reserve a record of \p len bytes.
+ * \return Payload area to fill, or NULL if the ring is full. */
+void *RTT_StagingReserve(RTT_Staging *ring, unsigned len);
+
+/** \brief Publish a record returned by RTT_StagingReserve. */
+void RTT_StagingCommit(RTT_Staging *ring, void *record);
+
+/** \brief Reserve, copy and commit \p len bytes in one call.
+ * \return false if the record was dropped. */
+bool RTT_StagingWrite(RTT_Staging *ring, const void *data, unsigned len);
+
+/** \brief Hand committed records to \p write, main loop only.
+ *
+ * Stops at the first uncommitted record or when the backend does not
+ * accept a whole record, so records stay staged while the RTT channel is
+ * full. The unwritten rest of a partly accepted record stays at the tail
+ * and is written first by the next drain.
+ * \return Number of bytes accepted by the backend.
+ */
+unsigned RTT_StagingDrain(RTT_Staging *ring, RTT_WriteFunc write, unsigned channel);
+
+/** \brief true if records were reserved since the last drain started.
+ *
+ * Records the last drain left staged because the channel was full do not
+ * count, so they do not keep the core awake until the host reads.
+ */
+bool RTT_StagingPending(const RTT_Staging *ring);
+
+#endif /* RTT_STAGING_H_ */
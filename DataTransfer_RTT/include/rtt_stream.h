@@ -0,0 +1,40 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_stream.h
+//!
+//! Format-free streaming output for bulk data.
+//!
+//! Frames of known length are appended to a batch buffer and handed to the
+//! output backend in one call once the batch is full, so there is no format
+//! parsing, no strlen and only one ring write per batch.
+//-----------------------------------------------------------------------------
+#ifndef RTT_STREAM_H_
+#define RTT_STREAM_H_
+
+#include <stdint.h>
+
+/** \brief Output backend, same signature as SEGGER_RTT_Write. */
+typedef unsigned (*RTT_WriteFunc)(unsigned channel, const void *data, unsigned len);
+
+/** \brief Batching stream state. */
+typedef struct {
+	RTT_WriteFunc write;    /**< Backend used on flush */
+	unsigned channel;       /**< RTT up-buffer index passed to the backend */
+	char *buf;              /**< Batch buffer */
+	unsigned size;          /**< Size of the batch buffer */
+	unsigned used;          /**< Bytes waiting in the batch buffer */
+	uint32_t written;       /**< Bytes accepted by the backend */
+	uint32_t dropped;       /**< Bytes the backend did not accept */
+} RTT_Stream;
+
+/** \brief Initialize \p s to batch into \p buf and flush through \p write. */
+void RTT_StreamInit(RTT_Stream *s, RTT_WriteFunc write, unsigned channel,
+		char *buf, unsigned size);
+
+/** \brief Append \p len bytes. Frames larger than the batch buffer are
+ * written through directly. */
+void RTT_StreamWrite(RTT_Stream *s, const void *data, unsigned len);
+
+/** \brief Hand all batched bytes to the backend. */
+void RTT_StreamFlush(RTT_Stream *s);
+
+#endif /* RTT_STREAM_H_ */
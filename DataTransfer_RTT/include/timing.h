@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+//! \file timing.h
+//!
+//! High resolution time source for benchmarks.
+//!
+//! Backends:
+//! - Cortex-M3 DWT cycle counter (default), one tick per core clock cycle.
+//! - BDK SoftwareTimer on RTE_SW_TIMER_INSTANCE, define USING_SW_TIMER.
+//! - clock_gettime(CLOCK_MONOTONIC) in nanoseconds when HOST_BUILD is defined.
+//!
+//! TIMING_Now() wraps at 2^32 ticks (about 89 s at 48 MHz for the cycle
+//! counter); differences of two readings stay correct across one wrap.
+//! TIMING_Now64() extends the counter to 64 bits as long as it is called at
+//! least once per wrap period.
+//-----------------------------------------------------------------------------
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <stdint.h>
+
+//#define USING_SW_TIMER
+
+/** \brief Start the selected time source. Call once after BDK_Initialize. */
+void TIMING_Initialize(void);
+
+/** \brief Current tick count, wraps at 2^32. */
+uint32_t TIMING_Now(void);
+
+/** \brief Current tick count extended to 64 bits. */
+uint64_t TIMING_Now64(void);
+
+/** \brief Tick rate of TIMING_Now in Hz. */
+uint32_t TIMING_TickHz(void);
+
+/** \brief Convert a tick count to nanoseconds. */
+uint64_t TIMING_TicksToNs(uint64_t ticks);
+
+/** \brief Convert a tick count to microseconds. */
+uint64_t TIMING_TicksToUs(uint64_t ticks);
+
+#endif /* TIMING_H_ */
@@ -0,0 +1,115 @@
+//-----------------------------------------------------------------------------
+//! \file wheel.h
+//!
+//! Hierarchical timing wheel for many concurrent software timers.
+//!
+//! Time is a free running 32-bit tick count supplied by the caller. The
+//! wheel has WHEEL_LEVELS levels of WHEEL_SLOTS slots; level L covers bits
+//! WHEEL_SLOT_BITS * L and up of the expiry time, so the levels together
+//! reach 2^30 ticks ahead (about 18 minutes at 1 us per tick, 22 s at
+//! 48 MHz). A timer goes to the level of the highest bit in which its
+//! expiry differs from the current time. When time reaches the start of a
+//! slot above level 0 its timers move down to a lower level; a level 0 slot
+//! holds timers that all expire at the same tick. Timers further away than
+//! the levels reach wait in an overflow list that is sorted in again each
+//! time bit 30 of the time changes.
+//!
+//! Each level has a bitmap of its non-empty slots, so the next slot to
+//! process is found with a bit scan per level and time can jump straight
+//! to it. Arm and cancel are O(1), every timer moves down at most
+//! WHEEL_LEVELS times before it expires, and memory is a fixed array of
+//! list heads. Timers are intrusive, no allocation is done.
+//!
+//! Slot lists are circular and doubly linked, a timer is appended at the
+//! tail and moved down in list order. Timers with the same expiry are
+//! always in the same list, so they run in the order they were armed;
+//! rearming a timer puts it behind the others. A callback may arm any
+//! timer again, including its own.
+//!
+//! WHEEL_NextEvent is the next point at which the wheel has work, which
+//! may be a move down a level. A sleeping caller wants WHEEL_NextExpiry
+//! instead, the earliest expiry itself, and lets WHEEL_Advance do the
+//! moves when it wakes.
+//!
+//! Define HOST_BUILD to build without the CMSIS intrinsics.
+//-----------------------------------------------------------------------------
+#ifndef WHEEL_H_
+#define WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** \brief Slots per level as a power of two, one bitmap word each. */
+#define WHEEL_SLOT_BITS     5
+#define WHEEL_SLOTS         (1u << WHEEL_SLOT_BITS)
+
+/** \brief Number of levels, WHEEL_SLOT_BITS * WHEEL_LEVELS must be < 31. */
+#define WHEEL_LEVELS        6
+
+/** \brief Ticks covered by the levels; later expiries use the overflow list. */
+#define WHEEL_RANGE_BITS    (WHEEL_SLOT_BITS * WHEEL_LEVELS)
+
+/** \brief Longest delay accepted by WHEEL_Start, in ticks. */
+#define WHEEL_MAX_DELAY     0x7fffffffu
+
+/** \brief Timer callback, called from WHEEL_Advance. */
+typedef void (*WHEEL_Callback)(void *arg);
+
+/** \brief One timer, owned by the caller. */
+typedef struct WHEEL_Timer {
+	struct WHEEL_Timer *next;   /**< Next timer of the list, circular */
+	struct WHEEL_Timer *prev;
+	uint32_t expiry;            /**< Tick at which the callback runs */
+	uint8_t level;              /**< WHEEL_LEVELS for the overflow list */
+	uint8_t slot;
+	bool armed;
+	WHEEL_Callback callback;
+	void *arg;
+} WHEEL_Timer;
+
+/** \brief Wheel state. */
+typedef struct {
+	uint32_t now;                                   /**< Time of the last advance */
+	uint32_t occupied[WHEEL_LEVELS];                /**< Non-empty slots per level */
+	WHEEL_Timer *slot[WHEEL_LEVELS][WHEEL_SLOTS];
+	WHEEL_Timer *overflow;
+	uint32_t armed;                                 /**< Timers currently armed */
+	uint32_t expired;                               /**< Callbacks run */
+	uint32_t cascaded;                              /**< Moves to a lower level */
+} WHEEL_Wheel;
+
+/** \brief Initialize \p w empty with the current time \p now. */
+void WHEEL_Init(WHEEL_Wheel *w, uint32_t now);
+
+/** \brief Prepare \p t to call \p callback(\p arg) when it expires. */
+void WHEEL_TimerInit(WHEEL_Timer *t, WHEEL_Callback callback, void *arg);
+
+/** \brief Arm \p t to expire at tick \p expiry, rearming if armed.
+ *
+ * An expiry that is not after the time of the last advance fires on the
+ * next advance. \p expiry must be less than WHEEL_MAX_DELAY ticks after
+ * that time.
+ */
+void WHEEL_Start(WHEEL_Wheel *w, WHEEL_Timer *t, uint32_t expiry);
+
+/** \brief Disarm \p t, nothing happens if it is not armed. */
+void WHEEL_Cancel(WHEEL_Wheel *w, WHEEL_Timer *t);
+
+/** \brief Ticks from the time of the last advance to the next slot that
+ * needs processing. This is the earliest expiry or an earlier point at
+ * which timers move down a level.
+ * \return false if no timer is armed. */
+bool WHEEL_NextEvent(const WHEEL_Wheel *w, uint32_t *ticks);
+
+/** \brief Ticks from the time of the last advance to the earliest expiry.
+ * Scans the timers of one slot when that slot is above level 0.
+ * \return false if no timer is armed. */
+bool WHEEL_NextExpiry(const WHEEL_Wheel *w, uint32_t *ticks);
+
+/** \brief Move time forward to \p now, less than 2^31 ticks after the last
+ * advance, and run the callbacks of all timers that expired, in expiry
+ * order. During a callback w->now is the expiry of that timer.
+ * \return Number of callbacks run. */
+unsigned WHEEL_Advance(WHEEL_Wheel *w, uint32_t now);
+
+#endif /* WHEEL_H_ */
@@ -0,0 +1,65 @@
+//-----------------------------------------------------------------------------
+//! \file wire_encode.h
+//!
+//! Interchangeable payload encodings for the RTT frame stream.
+//!
+//!     name     expansion        frame delimiter
+//!     hex      2                '\n'
+//!     base64   4/3, '=' padded  '\n'   (RFC 4648 alphabet)
+//!     base85   5/4              '\n'   (Ascii85 alphabet, no 'z' shortcut;
+//!                                       a final group of n bytes gives n + 1
+//!                                       characters)
+//!     cobs     1 + 1/254        0      (binary, consistent overhead byte
+//!                                       stuffing; the frame never contains
+//!                                       a 0 byte before the delimiter)
+//!
+//! The kernels work a word at a time: base64 turns 12 bytes loaded as three
+//! words into 16 characters stored as four, base85 converts one 32-bit word
+//! into 5 characters and COBS copies whole words that contain no zero byte.
+//! Like hex_encode.h the module only depends on the C library.
+//-----------------------------------------------------------------------------
+#ifndef WIRE_ENCODE_H_
+#define WIRE_ENCODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** \brief Characters produced for \p len bytes, without delimiter (COBS:
+ * worst case, a frame without zero bytes is one shorter per 254 bytes). */
+#define WIRE_BASE64_SIZE(len)   (4 * (((len) + 2) / 3))
+#define WIRE_BASE85_SIZE(len)   ((len) / 4 * 5 + (((len) % 4) ? (len) % 4 + 1 : 0))
+#define WIRE_COBS_SIZE(len)     ((len) + (len) / 254 + 1)
+
+/** \brief Largest frame of any encoder for \p len bytes, with delimiter. */
+#define WIRE_FRAME_SIZE(len)    (2 * (len) + 4)
+
+/** \brief One payload encoding. */
+typedef struct {
+	const char *name;
+	/** Encode \p len bytes, return pointer one past the last character */
+	char *(*encode)(char *dst, const uint8_t *src, size_t len);
+	/** Largest number of characters for \p len bytes, without delimiter */
+	unsigned (*size)(unsigned len);
+	char delimiter;     /**< Written after each frame */
+} WIRE_Encoder;
+
+extern const WIRE_Encoder WIRE_Hex;
+extern const WIRE_Encoder WIRE_Base64;
+extern const WIRE_Encoder WIRE_Base85;
+extern const WIRE_Encoder WIRE_Cobs;
+
+/** \brief Base64 encoder, see the file description. */
+char *WIRE_EncodeBase64(char *dst, const uint8_t *src, size_t len);
+
+/** \brief Ascii85 encoder, see the file description. */
+char *WIRE_EncodeBase85(char *dst, const uint8_t *src, size_t len);
+
+/** \brief COBS encoder, see the file description. */
+char *WIRE_EncodeCobs(char *dst, const uint8_t *src, size_t len);
+
+/** \brief Encode \p len bytes with \p encoder and append its delimiter.
+ * \param dst At least WIRE_FRAME_SIZE(len) characters.
+ * \return Number of characters written. */
+unsigned WIRE_EncodeFrame(const WIRE_Encoder *encoder, char *dst, const uint8_t *src, size_t len);
+
+#endif /* WIRE_ENCODE_H_ */
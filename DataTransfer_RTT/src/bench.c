@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+//! \file bench.c
+//!
+//! Output backend benchmark harness.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include "bench.h"
+
+void BENCH_Run(const BENCH_Backend *backend, const BENCH_Clock *clock,
+		const char *frame, unsigned len, unsigned loops, BENCH_Result *result,
+		LAT_Histogram *latency)
+{
+	uint32_t start;
+	uint32_t t;
+
+	if (backend->begin)
+	{
+		backend->begin();
+	}
+
+	start = clock->now();
+	if (latency)
+	{
+		for (unsigned i = 0; i < loops; i++)
+		{
+			t = clock->now();
+			backend->send(frame, len);
+			LAT_Record(latency, clock->now() - t);
+		}
+	}
+	else
+	{
+		for (unsigned i = 0; i < loops; i++)
+		{
+			backend->send(frame, len);
+		}
+	}
+	if (backend->end)
+	{
+		backend->end();
+	}
+	result->ticks = clock->now() - start;
+
+	result->backend = backend->name;
+	result->frame_len = len;
+	result->loops = loops;
+	result->bytes = len * loops;
+	BENCH_Compute(clock, result);
+}
+
+void BENCH_JobInit(BENCH_Job *job, const BENCH_Backend *backend, const BENCH_Clock *clock,
+		const char *frame, unsigned len, unsigned loops, BENCH_Result *result,
+		LAT_Histogram *latency)
+{
+	job->backend = backend;
+	job->clock = clock;
+	job->frame = frame;
+	job->len = len;
+	job->loops = loops;
+	job->result = result;
+	job->latency = latency;
+	job->ticks = 0;
+	CO_INIT(&job->co);
+}
+
+CO_Status BENCH_JobRun(BENCH_Job *job, CO_Slice *slice)
+{
+	const BENCH_Clock *clock = job->clock;
+	uint32_t t;
+
+	CO_SliceStart(slice);
+	CO_BEGIN(&job->co);
+
+	if (job->backend->begin)
+	{
+		job->backend->begin();
+	}
+
+	job->start = clock->now();
+	for (job->i = 0; job->i < job->loops; job->i++)
+	{
+		if (job->latency)
+		{
+			t = clock->now();
+			job->backend->send(job->frame, job->len);
+			LAT_Record(job->latency, clock->now() - t);
+		}
+		else
+		{
+			job->backend->send(job->frame, job->len);
+		}
+
+		if (job->i + 1 < job->loops && CO_SliceUsed(slice))
+		{
+			/* The clock stops while the main loop has its turn */
+			job->ticks += clock->now() - job->start;
+			CO_YIELD(&job->co);
+			job->start = clock->now();
+		}
+	}
+	if (job->backend->end)
+	{
+		job->backend->end();
+	}
+	job->result->ticks = job->ticks + (clock->now() - job->start);
+
+	job->result->backend = job->backend->name;
+	job->result->frame_len = job->len;
+	job->result->loops = job->loops;
+	job->result->bytes = job->len * job->loops;
+	BENCH_Compute(clock, job->result);
+
+	CO_END(&job->co);
+}
+
+void BENCH_Sweep(const BENCH_Backend *backends, unsigned count,
+		const BENCH_Clock *clock, const BENCH_SweepConfig *config,
+		BENCH_PrepareFunc prepare, BENCH_EmitFunc emit)
+{
+	BENCH_Result result;
+	const char *frame;
+	unsigned len;
+
+	for (unsigned b = 0; b < count; b++)
+	{
+		for (uint32_t size = config->size.first; size != 0;
+				size = BENCH_RangeNext(&config->size, size))
+		{
+			len = prepare(size, &frame);
+			for (uint32_t loops = config->loops.first; loops != 0;
+					loops = BENCH_RangeNext(&config->loops, loops))
+			{
+				BENCH_Run(&backends[b], clock, frame, len, loops, &result, NULL);
+				emit(&result);
+			}
+		}
+	}
+}
+
+void BENCH_SweepJobInit(BENCH_SweepJob *job, const BENCH_Backend *backends, unsigned count,
+		const BENCH_Clock *clock, const BENCH_SweepConfig *config,
+		BENCH_PrepareFunc prepare, BENCH_EmitFunc emit)
+{
+	job->backends = backends;
+	job->count = count;
+	job->clock = clock;
+	job->config = config;
+	job->prepare = prepare;
+	job->emit = emit;
+	CO_INIT(&job->co);
+}
+
+CO_Status BENCH_SweepJobRun(BENCH_SweepJob *job, CO_Slice *slice)
+{
+	const BENCH_SweepConfig *config = job->config;
+
+	CO_BEGIN(&job->co);
+
+	for (job->b = 0; job->b < job->count; job->b++)
+	{
+		for (job->size = config->size.first; job->size != 0;
+				job->size = BENCH_RangeNext(&config->size, job->size))
+		{
+			job->len = job->prepare(job->size, &job->frame);
+			for (job->loops = config->loops.first; job->loops != 0;
+					job->loops = BENCH_RangeNext(&config->loops, job->loops))
+			{
+				BENCH_JobInit(&job->run, &job->backends[job->b], job->clock, job->frame,
+						job->len, job->loops, &job->result, NULL);
+				CO_AWAIT(&job->co, BENCH_JobRun(&job->run, slice));
+				job->emit(&job->result);
+				CO_YIELD(&job->co);
+			}
+		}
+	}
+
+	CO_END(&job->co);
+}
+
+uint32_t BENCH_RangeNext(const BENCH_Range *range, uint32_t v)
+{
+	uint32_t next = v * range->mul + range->add;
+
+	/* Also stops ranges that would never advance */
+	if (next <= v || next > range->last)
+	{
+		return 0;
+	}
+
+	return next;
+}
+
+void BENCH_Compute(const BENCH_Clock *clock, BENCH_Result *result)
+{
+	uint64_t ticks = result->ticks;
+
+	result->us = (uint32_t)(ticks * 1000000u / clock->tick_hz);
+
+	/* A run shorter than one tick is reported as taking one tick */
+	if (ticks == 0)
+	{
+		ticks = 1;
+	}
+	result->bytes_per_s = (uint32_t)((uint64_t)result->bytes * clock->tick_hz / ticks);
+
+	if (result->bytes == 0)
+	{
+		result->cycles_per_byte_x100 = 0;
+	}
+	else
+	{
+		/* Split the division so cycles * 100 cannot overflow */
+		uint64_t cycles = ticks * clock->core_hz / clock->tick_hz;
+		result->cycles_per_byte_x100 = (uint32_t)(cycles / result->bytes * 100u
+				+ cycles % result->bytes * 100u / result->bytes);
+	}
+}
+
+int BENCH_FormatHeader(char *buf, unsigned size)
+{
+	return snprintf(buf, size, "bench,backend,frame,loops,bytes,ms,bytes_per_s,cycles_per_byte\n");
+}
+
+int BENCH_FormatRow(char *buf, unsigned size, const BENCH_Result *result)
+{
+	return snprintf(buf, size, "bench,%s,%lu,%lu,%lu,%lu.%03lu,%lu,%lu.%02lu\n",
+			result->backend,
+			(unsigned long)result->frame_len,
+			(unsigned long)result->loops,
+			(unsigned long)result->bytes,
+			(unsigned long)(result->us / 1000), (unsigned long)(result->us % 1000),
+			(unsigned long)result->bytes_per_s,
+			(unsigned long)(result->cycles_per_byte_x100 / 100),
+			(unsigned long)(result->cycles_per_byte_x100 % 100));
+}
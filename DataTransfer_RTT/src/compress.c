@@ -0,0 +1,274 @@
+//-----------------------------------------------------------------------------
+//! \file compress.c
+//!
+//! Streaming compression of payload data before it is written to RTT.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "compress.h"
+
+#define COMP_LZ_MIN_MATCH       3
+#define COMP_LZ_MAX_MATCH       (COMP_LZ_MIN_MATCH + 255)
+#define COMP_LZ_MASK            (COMP_LZ_WINDOW - 1)
+
+#define COMP_RLE_MAX_LITERAL    128
+#define COMP_RLE_MIN_RUN        3
+#define COMP_RLE_MAX_RUN        (COMP_RLE_MIN_RUN + 127)
+
+static inline unsigned COMP_LzHash(const uint8_t *p)
+{
+	uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+
+	return (v * 2654435761u) >> (32 - COMP_LZ_HASH_BITS);
+}
+
+/* Byte at stream position q, from this call's input or from the window */
+static inline uint8_t COMP_LzByteAt(const COMP_LzEncoder *s, const uint8_t *src,
+		uint32_t start, unsigned len, uint32_t q)
+{
+	uint32_t k = q - start;
+
+	return (k < len) ? src[k] : s->win[q & COMP_LZ_MASK];
+}
+
+void COMP_LzEncoderInit(COMP_LzEncoder *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+unsigned COMP_LzEncode(COMP_LzEncoder *s, uint8_t *dst, const uint8_t *src, unsigned len)
+{
+	uint32_t start = s->pos;
+	unsigned i = 0;
+	unsigned out = 0;
+	unsigned flags = 0;
+	unsigned bit = 8;
+
+	while (i < len)
+	{
+		uint32_t pos = start + i;
+		uint32_t dist = 0;
+		unsigned best = 0;
+
+		if (bit == 8)
+		{
+			flags = out++;
+			dst[flags] = 0;
+			bit = 0;
+		}
+
+		if (i + COMP_LZ_MIN_MATCH <= len)
+		{
+			unsigned h = COMP_LzHash(&src[i]);
+			unsigned max = len - i;
+
+			dist = pos - s->head[h];
+			s->head[h] = pos;
+
+			if (max > COMP_LZ_MAX_MATCH)
+			{
+				max = COMP_LZ_MAX_MATCH;
+			}
+			if (dist >= 1 && dist <= COMP_LZ_WINDOW)
+			{
+				/* Verify the candidate, the hash can collide */
+				while (best < max &&
+						COMP_LzByteAt(s, src, start, len, pos - dist + best) == src[i + best])
+				{
+					best++;
+				}
+			}
+		}
+
+		if (best >= COMP_LZ_MIN_MATCH)
+		{
+			dst[out++] = (uint8_t)(dist - 1);
+			dst[out++] = (uint8_t)(best - COMP_LZ_MIN_MATCH);
+
+			/* Positions inside the match are candidates for later matches */
+			s->win[pos & COMP_LZ_MASK] = src[i];
+			for (unsigned k = 1; k < best; k++)
+			{
+				if (i + k + COMP_LZ_MIN_MATCH <= len)
+				{
+					s->head[COMP_LzHash(&src[i + k])] = pos + k;
+				}
+				s->win[(pos + k) & COMP_LZ_MASK] = src[i + k];
+			}
+			i += best;
+		}
+		else
+		{
+			dst[flags] |= (uint8_t)(1u << bit);
+			dst[out++] = src[i];
+			s->win[pos & COMP_LZ_MASK] = src[i];
+			i++;
+		}
+		bit++;
+	}
+
+	s->pos = start + len;
+	return out;
+}
+
+void COMP_LzDecoderInit(COMP_LzDecoder *s)
+{
+	memset(s, 0, sizeof(*s));
+}
+
+int COMP_LzDecode(COMP_LzDecoder *s, uint8_t *dst, unsigned size, const uint8_t *src, unsigned len)
+{
+	unsigned i = 0;
+	unsigned out = 0;
+	unsigned flags = 0;
+	unsigned bit = 8;
+
+	while (i < len)
+	{
+		if (bit == 8)
+		{
+			flags = src[i++];
+			bit = 0;
+			if (i == len)
+			{
+				return -1;
+			}
+		}
+
+		if (flags & (1u << bit))
+		{
+			if (out >= size)
+			{
+				return -1;
+			}
+			dst[out++] = src[i];
+			s->win[s->pos++ & COMP_LZ_MASK] = src[i++];
+		}
+		else
+		{
+			uint32_t dist;
+			unsigned n;
+
+			if (i + 2 > len)
+			{
+				return -1;
+			}
+			dist = (uint32_t)src[i] + 1;
+			n = (unsigned)src[i + 1] + COMP_LZ_MIN_MATCH;
+			i += 2;
+			if (dist > s->pos || out + n > size)
+			{
+				return -1;
+			}
+
+			/* Byte by byte, a match may overlap the bytes it produces */
+			while (n--)
+			{
+				uint8_t b = s->win[(s->pos - dist) & COMP_LZ_MASK];
+
+				dst[out++] = b;
+				s->win[s->pos++ & COMP_LZ_MASK] = b;
+			}
+		}
+		bit++;
+	}
+
+	return (int)out;
+}
+
+void COMP_RleInit(COMP_RleState *s)
+{
+	s->prev = 0;
+}
+
+unsigned COMP_RleEncode(COMP_RleState *s, uint8_t *dst, const uint8_t *src, unsigned len)
+{
+	uint8_t prev = s->prev;
+	unsigned i = 0;
+	unsigned out = 0;
+	unsigned literal = 0;
+	unsigned control = 0;
+
+	while (i < len)
+	{
+		uint8_t delta = (uint8_t)(src[i] - prev);
+		unsigned run = 1;
+
+		while (i + run < len && run < COMP_RLE_MAX_RUN &&
+				(uint8_t)(src[i + run] - src[i + run - 1]) == delta)
+		{
+			run++;
+		}
+
+		if (run >= COMP_RLE_MIN_RUN)
+		{
+			dst[out++] = (uint8_t)(run - COMP_RLE_MIN_RUN + 128);
+			dst[out++] = delta;
+			literal = 0;
+			i += run;
+		}
+		else
+		{
+			if (literal == 0)
+			{
+				control = out++;
+			}
+			dst[control] = (uint8_t)literal;
+			dst[out++] = delta;
+			if (++literal == COMP_RLE_MAX_LITERAL)
+			{
+				literal = 0;
+			}
+			i++;
+		}
+		prev = src[i - 1];
+	}
+
+	s->prev = prev;
+	return out;
+}
+
+int COMP_RleDecode(COMP_RleState *s, uint8_t *dst, unsigned size, const uint8_t *src, unsigned len)
+{
+	uint8_t prev = s->prev;
+	unsigned i = 0;
+	unsigned out = 0;
+
+	while (i < len)
+	{
+		unsigned control = src[i++];
+
+		if (control < 128)
+		{
+			unsigned n = control + 1;
+
+			if (i + n > len || out + n > size)
+			{
+				return -1;
+			}
+			while (n--)
+			{
+				prev = (uint8_t)(prev + src[i++]);
+				dst[out++] = prev;
+			}
+		}
+		else
+		{
+			unsigned n = control - 128 + COMP_RLE_MIN_RUN;
+			uint8_t delta;
+
+			if (i >= len || out + n > size)
+			{
+				return -1;
+			}
+			delta = src[i++];
+			while (n--)
+			{
+				prev = (uint8_t)(prev + delta);
+				dst[out++] = prev;
+			}
+		}
+	}
+
+	s->prev = prev;
+	return (int)out;
+}
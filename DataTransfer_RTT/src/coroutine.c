@@ -0,0 +1,30 @@
+//-----------------------------------------------------------------------------
+//! \file coroutine.c
+//!
+//! Stackless cooperative coroutines (protothreads) for long running jobs.
+//-----------------------------------------------------------------------------
+#include "coroutine.h"
+
+void CO_SliceInit(CO_Slice *slice, uint32_t (*now)(void), uint32_t units, uint32_t ticks)
+{
+	slice->now = now;
+	slice->units = units;
+	slice->ticks = ticks;
+	CO_SliceStart(slice);
+}
+
+void CO_SliceStart(CO_Slice *slice)
+{
+	slice->count = 0;
+	slice->start = slice->ticks ? slice->now() : 0;
+}
+
+bool CO_SliceUsed(CO_Slice *slice)
+{
+	slice->count++;
+	if (slice->units != 0 && slice->count >= slice->units)
+	{
+		return true;
+	}
+	return slice->ticks != 0 && slice->now() - slice->start >= slice->ticks;
+}
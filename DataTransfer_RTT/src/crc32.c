@@ -0,0 +1,65 @@
+//-----------------------------------------------------------------------------
+//! \file crc32.c
+//!
+//! CRC-32 (IEEE 802.3, reflected polynomial 0xEDB88320) using slice-by-4.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "crc32.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error crc32.c assumes a little endian target
+#endif
+
+#define CRC32_POLY    0xEDB88320u
+
+static uint32_t crc32_table[4][256];
+
+void CRC32_Initialize(void)
+{
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c >> 1) ^ ((c & 1) ? CRC32_POLY : 0);
+		}
+		crc32_table[0][i] = c;
+	}
+
+	/* Table n advances the CRC of a byte by n further zero bytes */
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (int t = 1; t < 4; t++)
+		{
+			uint32_t c = crc32_table[t - 1][i];
+			crc32_table[t][i] = (c >> 8) ^ crc32_table[0][c & 0xff];
+		}
+	}
+}
+
+uint32_t CRC32_Update(uint32_t crc, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+	uint32_t w;
+
+	crc = ~crc;
+
+	while (len >= 4)
+	{
+		memcpy(&w, p, sizeof(w));
+		crc ^= w;
+		crc = crc32_table[3][crc & 0xff] ^
+		      crc32_table[2][(crc >> 8) & 0xff] ^
+		      crc32_table[1][(crc >> 16) & 0xff] ^
+		      crc32_table[0][crc >> 24];
+		p += 4;
+		len -= 4;
+	}
+
+	while (len--)
+	{
+		crc = (crc >> 8) ^ crc32_table[0][(crc ^ *p++) & 0xff];
+	}
+
+	return ~crc;
+}
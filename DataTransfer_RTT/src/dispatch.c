@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+//! \file dispatch.c
+//!
+//! Priority event dispatcher run next to BDK_Schedule.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#ifndef HOST_BUILD
+#include <BDK.h>
+#endif
+#include "dispatch.h"
+#include "timing.h"
+
+/* End of a list */
+#define DISP_NONE           0xff
+
+#define DISP_BIT(priority)  (0x80000000u >> (priority))
+
+/* Mask interrupts, returns the state to restore */
+static inline uint32_t DISP_Lock(void)
+{
+#ifdef HOST_BUILD
+	return 0;
+#else
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	return primask;
+#endif
+}
+
+static inline void DISP_Unlock(uint32_t primask)
+{
+#ifdef HOST_BUILD
+	(void)primask;
+#else
+	__set_PRIMASK(primask);
+#endif
+}
+
+static inline unsigned DISP_Highest(uint32_t ready)
+{
+#ifdef HOST_BUILD
+	return (unsigned)__builtin_clz(ready);
+#else
+	return __CLZ(ready);
+#endif
+}
+
+void DISP_Init(DISP_Dispatcher *d)
+{
+	for (unsigned i = 0; i < DISP_POOL_SIZE; i++)
+	{
+		d->pool[i].next = (i + 1 < DISP_POOL_SIZE) ? (uint8_t)(i + 1) : DISP_NONE;
+	}
+	for (unsigned p = 0; p < DISP_PRIORITY_COUNT; p++)
+	{
+		d->head[p] = DISP_NONE;
+		d->tail[p] = DISP_NONE;
+		d->wait[p] = NULL;
+	}
+	d->free = 0;
+	d->ready = 0;
+	d->dispatched = 0;
+	d->dropped = 0;
+}
+
+void DISP_SetWaitHistogram(DISP_Dispatcher *d, unsigned priority, LAT_Histogram *wait)
+{
+	if (priority < DISP_PRIORITY_COUNT)
+	{
+		d->wait[priority] = wait;
+	}
+}
+
+bool DISP_Post(DISP_Dispatcher *d, unsigned priority, DISP_Handler handler, void *arg)
+{
+	uint32_t now = TIMING_Now();
+	uint32_t primask;
+	uint8_t e;
+
+	if (priority >= DISP_PRIORITY_COUNT)
+	{
+		return false;
+	}
+
+	primask = DISP_Lock();
+	e = d->free;
+	if (e == DISP_NONE)
+	{
+		d->dropped++;
+		DISP_Unlock(primask);
+		return false;
+	}
+	d->free = d->pool[e].next;
+
+	d->pool[e].handler = handler;
+	d->pool[e].arg = arg;
+	d->pool[e].posted = now;
+	d->pool[e].next = DISP_NONE;
+
+	if (d->head[priority] == DISP_NONE)
+	{
+		d->head[priority] = e;
+	}
+	else
+	{
+		d->pool[d->tail[priority]].next = e;
+	}
+	d->tail[priority] = e;
+	d->ready |= DISP_BIT(priority);
+	DISP_Unlock(primask);
+	return true;
+}
+
+bool DISP_Dispatch(DISP_Dispatcher *d)
+{
+	DISP_Event event;
+	uint32_t primask;
+	unsigned p;
+	uint8_t e;
+
+	primask = DISP_Lock();
+	if (d->ready == 0)
+	{
+		DISP_Unlock(primask);
+		return false;
+	}
+
+	/* Unlink the oldest event of the most urgent priority */
+	p = DISP_Highest(d->ready);
+	e = d->head[p];
+	event = d->pool[e];
+	d->head[p] = event.next;
+	if (event.next == DISP_NONE)
+	{
+		d->tail[p] = DISP_NONE;
+		d->ready &= ~DISP_BIT(p);
+	}
+	d->pool[e].next = d->free;
+	d->free = e;
+	DISP_Unlock(primask);
+
+	if (d->wait[p] != NULL)
+	{
+		LAT_Record(d->wait[p], TIMING_Now() - event.posted);
+	}
+	event.handler(event.arg);
+	d->dispatched++;
+	return true;
+}
+
+bool DISP_Pending(const DISP_Dispatcher *d)
+{
+	return d->ready != 0;
+}
+
+unsigned DISP_Run(DISP_Dispatcher *d, unsigned max)
+{
+	unsigned n = 0;
+
+	while (n < max && DISP_Dispatch(d))
+	{
+		n++;
+	}
+	return n;
+}
@@ -0,0 +1,34 @@
+//-----------------------------------------------------------------------------
+//! \file frame.c
+//!
+//! Optional framing of streamed hex frames with a sequence number and CRC.
+//-----------------------------------------------------------------------------
+#include "frame.h"
+#include "crc32.h"
+#include "hex_encode.h"
+
+static char *FRAME_PutU32(char *dst, uint32_t v)
+{
+	uint8_t be[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+
+	return HEX_EncodeSwar(dst, be, sizeof(be), HEX_UPPER);
+}
+
+unsigned FRAME_Encode(char *dst, uint32_t seq, const uint8_t *payload, size_t len)
+{
+	uint8_t le[4] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24) };
+	uint32_t crc = CRC32_Update(0, le, sizeof(le));
+	char *p = dst;
+
+	crc = CRC32_Update(crc, payload, len);
+
+	*p++ = 'F';
+	p = FRAME_PutU32(p, seq);
+	*p++ = ':';
+	p = HEX_EncodeSwar(p, payload, len, HEX_UPPER);
+	*p++ = ':';
+	p = FRAME_PutU32(p, crc);
+	*p++ = '\n';
+
+	return (unsigned)(p - dst);
+}
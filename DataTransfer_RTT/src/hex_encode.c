@@ -0,0 +1,122 @@
+//-----------------------------------------------------------------------------
+//! \file hex_encode.c
+//!
+//! Byte to ASCII hex encoders used by the RTT data transfer benchmark.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "hex_encode.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error hex_encode.c assumes a little endian target
+#endif
+
+/* Each entry holds the two characters of one byte, first character in the
+ * low half so a little endian 16-bit store emits them in order. */
+#define HEX_CHAR(n)     ((n) < 10 ? '0' + (n) : 'A' + (n) - 10)
+#define HEX_PAIR(b)     (uint16_t)(HEX_CHAR((b) >> 4) | (HEX_CHAR((b) & 0x0f) << 8))
+#define HEX_ROW(b)      HEX_PAIR(b), HEX_PAIR(b + 1), HEX_PAIR(b + 2), HEX_PAIR(b + 3), \
+                        HEX_PAIR(b + 4), HEX_PAIR(b + 5), HEX_PAIR(b + 6), HEX_PAIR(b + 7), \
+                        HEX_PAIR(b + 8), HEX_PAIR(b + 9), HEX_PAIR(b + 10), HEX_PAIR(b + 11), \
+                        HEX_PAIR(b + 12), HEX_PAIR(b + 13), HEX_PAIR(b + 14), HEX_PAIR(b + 15)
+
+static const uint16_t hex_lut[256] =
+{
+	HEX_ROW(0x00), HEX_ROW(0x10), HEX_ROW(0x20), HEX_ROW(0x30),
+	HEX_ROW(0x40), HEX_ROW(0x50), HEX_ROW(0x60), HEX_ROW(0x70),
+	HEX_ROW(0x80), HEX_ROW(0x90), HEX_ROW(0xA0), HEX_ROW(0xB0),
+	HEX_ROW(0xC0), HEX_ROW(0xD0), HEX_ROW(0xE0), HEX_ROW(0xF0)
+};
+
+char *HEX_Encode(char *dst, const uint8_t *src, size_t len)
+{
+	uint32_t in;
+	uint32_t out[2];
+
+	/* Word at a time: one 32-bit load, four table reads, two 32-bit stores.
+	 * memcpy keeps the unaligned accesses legal, GCC turns it into LDR/STR. */
+	while (len >= 4)
+	{
+		memcpy(&in, src, sizeof(in));
+		out[0] = hex_lut[in & 0xff] | ((uint32_t)hex_lut[(in >> 8) & 0xff] << 16);
+		out[1] = hex_lut[(in >> 16) & 0xff] | ((uint32_t)hex_lut[in >> 24] << 16);
+		memcpy(dst, out, sizeof(out));
+		src += 4;
+		dst += 8;
+		len -= 4;
+	}
+
+	while (len--)
+	{
+		memcpy(dst, &hex_lut[*src++], 2);
+		dst += 2;
+	}
+
+	return dst;
+}
+
+/* Turn two bytes into four characters. The nibbles are spread into the four
+ * byte lanes of a word, high nibble first. Adding 6 to a lane sets its bit 4
+ * exactly when the nibble is 10..15; that bit is widened into the distance
+ * between '9' + 1 and 'A' (7) or 'a' (39). No lane exceeds 0x66 so carries
+ * never cross into the next lane. */
+static inline uint32_t HEX_SwarPair(uint32_t w, HEX_Case letter_case)
+{
+	uint32_t t = (w & 0xff) | ((w & 0xff00) << 8);
+	uint32_t n = ((t >> 4) & 0x000f000f) | ((t & 0x000f000f) << 8);
+	uint32_t m = ((n + 0x06060606) >> 4) & 0x01010101;
+	uint32_t fix = (m << 3) - m;
+
+	if (letter_case == HEX_LOWER)
+	{
+		fix += m << 5;
+	}
+
+	return n + 0x30303030 + fix;
+}
+
+char *HEX_EncodeSwar(char *dst, const uint8_t *src, size_t len, HEX_Case letter_case)
+{
+	uint32_t in;
+	uint32_t out[2];
+
+	while (len >= 4)
+	{
+		memcpy(&in, src, sizeof(in));
+		out[0] = HEX_SwarPair(in, letter_case);
+		out[1] = HEX_SwarPair(in >> 16, letter_case);
+		memcpy(dst, out, sizeof(out));
+		src += 4;
+		dst += 8;
+		len -= 4;
+	}
+
+	while (len--)
+	{
+		out[0] = HEX_SwarPair(*src++, letter_case);
+		memcpy(dst, out, 2);
+		dst += 2;
+	}
+
+	return dst;
+}
+
+char *HEX_EncodeNibble(char *dst, const uint8_t *src, size_t len)
+{
+	for (size_t j = 0; j < len; j++)
+	{
+		*dst = (src[j] >> 4);
+		*dst += '0';
+		if (*dst > '9') {
+			*dst += 7;
+		}
+		dst++;
+		*dst = (src[j] & 0x0f);
+		*dst += '0';
+		if (*dst > '9') {
+			*dst += 7;
+		}
+		dst++;
+	}
+
+	return dst;
+}
@@ -0,0 +1,258 @@
+//-----------------------------------------------------------------------------
+//! \file idle.c
+//!
+//! Tickless idle: sleep until the next software timer deadline.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <stdio.h>
+#include "idle.h"
+
+#ifndef HOST_BUILD
+
+#include <BDK.h>
+#include "timing.h"
+
+/* TIMER2 counts SLOWCLK / 2, SLOWCLK is 1 MHz after BDK_Initialize */
+#define IDLE_TIMER_HZ           500000u
+#define IDLE_TIMER_MAX_COUNT    0x00ffffffu
+
+static uint32_t idle_timer_hz;
+static uint32_t idle_wakeup_count;      /* TIMER2 counts of the one-shot, 0: none */
+static uint32_t idle_wakeup_start;      /* IDLE_DeviceNow() when it started */
+static uint32_t idle_gated_ticks;       /* Ticks TIMING_Now missed while asleep */
+
+/* TIMING_Now plus what it missed in WFI, see IDLE_DeviceRebase */
+static uint32_t IDLE_DeviceNow(void)
+{
+	return TIMING_Now() + idle_gated_ticks;
+}
+
+static void IDLE_DeviceSetWakeup(uint32_t ticks)
+{
+	uint64_t count;
+
+	Sys_Timers_Stop(SELECT_TIMER2);
+	NVIC_ClearPendingIRQ(TIMER2_IRQn);
+	idle_wakeup_count = 0;
+	if (ticks == 0)
+	{
+		return;
+	}
+
+	/* Round up, an early wakeup would only cost another sleep */
+	count = ((uint64_t)ticks * IDLE_TIMER_HZ + idle_timer_hz - 1) / idle_timer_hz;
+	if (count > IDLE_TIMER_MAX_COUNT)
+	{
+		count = IDLE_TIMER_MAX_COUNT;
+	}
+	Sys_Timer_Set_Control(2, TIMER_SHOT_MODE | TIMER_SLOWCLK_DIV2 | TIMER_PRESCALE_1 |
+			(uint32_t)(count ? count - 1 : 0));
+	idle_wakeup_start = IDLE_DeviceNow();
+	idle_wakeup_count = (uint32_t)count;
+	Sys_Timers_Start(SELECT_TIMER2);
+}
+
+/* The DWT cycle counter behind TIMING_Now stops whenever WFI gates the core
+ * clock, which would make every later expiry late by the time slept. TIMER2
+ * runs from SLOWCLK either way, so the counts it has done since the one-shot
+ * started are a lower bound of the time that passed; what the clock fell
+ * short of it is added to IDLE_DeviceNow. TIMER_VAL counts down from the
+ * loaded value and the interrupt stays pending while PRIMASK is set. A sleep
+ * without a one-shot cannot be measured, it only happens with no timer
+ * armed and then only the asleep statistics come out short. */
+static void IDLE_DeviceRebase(void)
+{
+	uint32_t done;
+	uint32_t left;
+	uint32_t timer_ticks;
+	uint32_t elapsed;
+
+	if (idle_wakeup_count == 0)
+	{
+		return;
+	}
+
+	if (NVIC_GetPendingIRQ(TIMER2_IRQn))
+	{
+		done = idle_wakeup_count;
+	}
+	else
+	{
+		left = TIMER->VAL[2] & IDLE_TIMER_MAX_COUNT;
+		done = (left < idle_wakeup_count) ? idle_wakeup_count - 1 - left : 0;
+	}
+	timer_ticks = (uint32_t)((uint64_t)done * idle_timer_hz / IDLE_TIMER_HZ);
+
+	elapsed = IDLE_DeviceNow() - idle_wakeup_start;
+	if (timer_ticks > elapsed)
+	{
+		idle_gated_ticks += timer_ticks - elapsed;
+	}
+}
+
+/* WFI with PRIMASK set still wakes on a pending interrupt, which then runs
+ * after __enable_irq; nothing posted after the check is slept through */
+static bool IDLE_DeviceSleep(IDLE_PendingFunc pending, void *arg)
+{
+	bool idle;
+
+	__disable_irq();
+	idle = !pending(arg);
+	if (idle)
+	{
+		SYS_WAIT_FOR_INTERRUPT;
+		IDLE_DeviceRebase();
+	}
+	__enable_irq();
+	return idle;
+}
+
+IDLE_Port IDLE_DevicePort = { IDLE_DeviceNow, IDLE_DeviceSetWakeup, IDLE_DeviceSleep, 0 };
+
+void IDLE_DeviceInitialize(void)
+{
+	uint64_t max;
+
+	idle_timer_hz = TIMING_TickHz();
+
+	/* Longest one-shot, kept below half the TIMING_Now wrap period */
+	max = (uint64_t)IDLE_TIMER_MAX_COUNT * idle_timer_hz / IDLE_TIMER_HZ;
+	IDLE_DevicePort.max_wakeup = (max < 0x7fffffffu) ? (uint32_t)max : 0x7fffffffu;
+
+	NVIC_EnableIRQ(TIMER2_IRQn);
+}
+
+/* The interrupt only ends the WFI, the main loop runs the timers */
+void TIMER2_IRQHandler(void)
+{
+}
+
+#endif /* HOST_BUILD */
+
+void IDLE_Init(IDLE_Manager *m, const IDLE_Port *port)
+{
+	m->port = port;
+	m->last = port->now();
+	WHEEL_Init(&m->wheel, m->last);
+	m->awake_ticks = 0;
+	m->asleep_ticks = 0;
+	m->sleeps = 0;
+	m->wakeups_set = 0;
+	m->expired = 0;
+	m->skipped = 0;
+	m->pending = NULL;
+	m->pending_arg = NULL;
+	m->wake_at = 0;
+	m->wake_armed = false;
+}
+
+void IDLE_SetPending(IDLE_Manager *m, IDLE_PendingFunc pending, void *arg)
+{
+	m->pending = pending;
+	m->pending_arg = arg;
+}
+
+void IDLE_TimerInit(IDLE_Timer *t, IDLE_Callback callback, void *arg)
+{
+	WHEEL_TimerInit(t, callback, arg);
+}
+
+void IDLE_TimerStart(IDLE_Manager *m, IDLE_Timer *t, uint32_t delay)
+{
+	WHEEL_Start(&m->wheel, t, m->port->now() + delay);
+}
+
+void IDLE_TimerStop(IDLE_Manager *m, IDLE_Timer *t)
+{
+	WHEEL_Cancel(&m->wheel, t);
+}
+
+bool IDLE_NextDeadline(const IDLE_Manager *m, uint32_t now, uint32_t *delay)
+{
+	uint32_t ticks;
+	uint32_t event;
+
+	if (!WHEEL_NextExpiry(&m->wheel, &ticks))
+	{
+		return false;
+	}
+
+	/* The wheel counts from its last advance, which may be before now */
+	event = m->wheel.now + ticks;
+	*delay = ((int32_t)(event - now) > 0) ? event - now : 0;
+	return true;
+}
+
+unsigned IDLE_RunExpired(IDLE_Manager *m)
+{
+	unsigned n = WHEEL_Advance(&m->wheel, m->port->now());
+
+	m->expired += n;
+	return n;
+}
+
+/* Called by the port with interrupts masked */
+static bool IDLE_SleepPending(void *arg)
+{
+	IDLE_Manager *m = arg;
+
+	/* The wakeup interrupt may have fired before interrupts were masked */
+	if (m->wake_armed && (int32_t)(m->port->now() - m->wake_at) >= 0)
+	{
+		return true;
+	}
+	return m->pending != NULL && m->pending(m->pending_arg);
+}
+
+void IDLE_Sleep(IDLE_Manager *m)
+{
+	const IDLE_Port *port = m->port;
+	uint32_t start = port->now();
+	uint32_t delay;
+	bool timed = IDLE_NextDeadline(m, start, &delay);
+
+	m->awake_ticks += start - m->last;
+	m->last = start;
+	if (timed && delay == 0)
+	{
+		return;
+	}
+
+	if (timed)
+	{
+		if (delay > port->max_wakeup)
+		{
+			delay = port->max_wakeup;
+		}
+		port->set_wakeup(delay);
+		m->wake_at = start + delay;
+	}
+	else
+	{
+		port->set_wakeup(0);
+	}
+	m->wake_armed = timed;
+
+	if (!port->sleep(IDLE_SleepPending, m))
+	{
+		m->skipped++;
+		return;
+	}
+
+	m->last = port->now();
+	m->asleep_ticks += m->last - start;
+	m->sleeps++;
+	m->wakeups_set += timed;
+}
+
+int IDLE_FormatStats(char *buf, unsigned size, const IDLE_Manager *m, uint32_t tick_hz)
+{
+	uint64_t total = m->awake_ticks + m->asleep_ticks;
+
+	return snprintf(buf, size, "idle,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+			(unsigned long)(m->awake_ticks * 1000000u / tick_hz),
+			(unsigned long)(m->asleep_ticks * 1000000u / tick_hz),
+			(unsigned long)(total ? m->asleep_ticks * 1000u / total : 0),
+			(unsigned long)m->sleeps, (unsigned long)m->wakeups_set,
+			(unsigned long)m->expired, (unsigned long)m->skipped);
+}
@@ -0,0 +1,133 @@
+//-----------------------------------------------------------------------------
+//! \file latency.c
+//!
+//! Per-call latency recorder with a log-scaled histogram.
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <string.h>
+#include "latency.h"
+
+void LAT_Reset(LAT_Histogram *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = UINT32_MAX;
+}
+
+void LAT_Record(LAT_Histogram *h, uint32_t ticks)
+{
+	h->count++;
+	h->sum += ticks;
+	if (ticks < h->min)
+	{
+		h->min = ticks;
+	}
+	if (ticks > h->max)
+	{
+		h->max = ticks;
+	}
+	h->bucket[LAT_BucketIndex(ticks)]++;
+}
+
+unsigned LAT_BucketIndex(uint32_t ticks)
+{
+	unsigned msb;
+
+	if (ticks < 4)
+	{
+		return ticks;
+	}
+
+	/* 4 buckets per octave, chosen by the two bits below the msb */
+	msb = 31 - __builtin_clz(ticks);
+	return (msb - 1) * 4 + ((ticks >> (msb - 2)) & 3);
+}
+
+uint32_t LAT_BucketLow(unsigned index)
+{
+	if (index < 4)
+	{
+		return index;
+	}
+
+	return (uint32_t)(4 + index % 4) << (index / 4 - 1);
+}
+
+uint32_t LAT_BucketHigh(unsigned index)
+{
+	if (index < 4)
+	{
+		return index;
+	}
+
+	return LAT_BucketLow(index) + ((uint32_t)1 << (index / 4 - 1)) - 1;
+}
+
+uint32_t LAT_Percentile(const LAT_Histogram *h, unsigned permille)
+{
+	uint32_t rank;
+	uint32_t seen = 0;
+
+	if (h->count == 0)
+	{
+		return 0;
+	}
+
+	/* Rank of the sample, rounded up so p100 is the last sample */
+	rank = (uint32_t)(((uint64_t)h->count * permille + 999) / 1000);
+	if (rank == 0)
+	{
+		rank = 1;
+	}
+
+	for (unsigned i = 0; i < LAT_BUCKET_COUNT; i++)
+	{
+		seen += h->bucket[i];
+		if (seen >= rank)
+		{
+			uint32_t high = LAT_BucketHigh(i);
+			if (high > h->max)
+			{
+				high = h->max;
+			}
+			return (high < h->min) ? h->min : high;
+		}
+	}
+
+	return h->max;
+}
+
+/* Saturates at LAT_NS_MAX; newlib-nano printf has no %llu for 64 bits */
+static unsigned long LAT_ToNs(uint64_t ticks, uint32_t tick_hz)
+{
+	uint64_t ns = ticks * 1000000000u / tick_hz;
+
+	return (ns < LAT_NS_MAX) ? (unsigned long)ns : (unsigned long)LAT_NS_MAX;
+}
+
+int LAT_FormatSummary(char *buf, unsigned size, const char *name,
+		const LAT_Histogram *h, uint32_t tick_hz)
+{
+	uint64_t mean = (h->count > 0) ? h->sum / h->count : 0;
+
+	return snprintf(buf, size, "lat,%s,%lu,%lu,%lu,%lu,%lu,%lu\n", name,
+			(unsigned long)h->count,
+			LAT_ToNs((h->count > 0) ? h->min : 0, tick_hz),
+			LAT_ToNs(LAT_Percentile(h, 500), tick_hz),
+			LAT_ToNs(LAT_Percentile(h, 990), tick_hz),
+			LAT_ToNs(h->max, tick_hz),
+			LAT_ToNs(mean, tick_hz));
+}
+
+int LAT_FormatBucket(char *buf, unsigned size, const char *name,
+		const LAT_Histogram *h, unsigned index, uint32_t tick_hz)
+{
+	if (h->bucket[index] == 0)
+	{
+		return 0;
+	}
+
+	return snprintf(buf, size, "hist,%s,%lu,%lu,%lu\n", name,
+			LAT_ToNs(LAT_BucketLow(index), tick_hz),
+			LAT_ToNs(LAT_BucketHigh(index), tick_hz),
+			(unsigned long)h->bucket[index]);
+}
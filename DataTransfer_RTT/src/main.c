@@ -18,46 +18,141 @@
 
 #include <stdio.h>
 #include "main.h"
-
-
-//#define USING_SW_TIMER
+#include "hex_encode.h"
+#include "rtt_reserve.h"
+#include "rtt_stream.h"
+#include "bench.h"
+#include "timing.h"
+#include "latency.h"
+#include "prng.h"
+#include "crc32.h"
+#include "frame.h"
+#include "log.h"
+#include "rtt_channel.h"
+#include "rtt_staging.h"
+#include "pipeline.h"
+#include "compress.h"
+#include "wire_encode.h"
+#include "dispatch.h"
+#include "coroutine.h"
+#include "idle.h"
 
 
 #define BUFF_SIZE 1024
 #define SEND_SIZE 80
 #define SEND_LOOP 2500
+#define STREAM_BATCH_SIZE 1024
+#define STAGING_SIZE 512
+
+/* Dispatcher priorities, 0 runs first */
+#define PRIO_BUTTON 0
+
+/* Turn of a running test before BDK_Schedule runs again, defaults of test_yield */
+#define TEST_YIELD_FRAMES 100
+#define TEST_YIELD_US 2000
+
+/* Stall after which a pipeline frame is dropped, as the bulk channel timeout */
+#define PIPE_TIMEOUT_US 10000
+
+/* Interval of the "idle,..." line on the metrics channel */
+#define IDLE_REPORT_MS 10000
 
 uint8_t buffer_1024_Byte[BUFF_SIZE];
+uint32_t test_seed = 1;     // payload seed, reported as "seed,<n>" before each test
+PRNG_State prng;
 char    send_buffer_Char[2*BUFF_SIZE+2];
 uint32_t printf_sending_time;
+char    stream_batch[STREAM_BATCH_SIZE];
+char    frame_buffer_Char[FRAME_ENCODED_SIZE(COMP_LZ_BOUND(BUFF_SIZE))];
+uint8_t comp_buffer[COMP_LZ_BOUND(BUFF_SIZE)];
+COMP_LzEncoder lz_encoder;
+COMP_RleState rle_encoder;
+uint32_t frame_seq;
+RTT_Stream stream;
+char    bench_line[BENCH_LINE_SIZE];
+uint32_t staging_buffer[STAGING_SIZE / 4];
+RTT_Staging staging;     // messages from ISRs and callbacks, drained in the main loop
+char    pipe_buffer[2][2*SEND_SIZE+1];
+PIPE_Pipeline pipe;
+unsigned pipe_frames_left;
+DISP_Dispatcher dispatcher;     // prioritized events posted by ISRs, run in the main loop
+
+//Frames and microseconds per turn of a running test, 0 disables that limit; set
+//both to 0 from the debugger to measure without yielding
+uint32_t test_yield_frames = TEST_YIELD_FRAMES;
+uint32_t test_yield_us = TEST_YIELD_US;
+CO_State test_co;
+CO_State run_co;            // RunTest or RunSweep, one turn per main loop pass
+bool test_running = false;
+bool sweep_running = false;
+IDLE_Manager idle;          // application timers and sleep accounting
+IDLE_Timer idle_report;
+
+//Points measured by ExecuteSweep, can be changed from the debugger at runtime;
+//sizes whose frame does not fit the bulk up-buffer are left out
+BENCH_SweepConfig sweep_config = {
+	.size = { .first = 1, .last = BUFF_SIZE, .mul = 2, .add = 0 },
+	.loops = { .first = 250, .last = SEND_LOOP, .mul = 10, .add = 0 },
+};
 
 
 volatile bool start_test = false;
+volatile bool start_sweep = false;
 void SetupTestData(void);
-void ExecuteTest(void);
+void Bulk_PrintSeed(const char *label, unsigned frames, bool repeat);
+CO_Status ExecuteTest(void);
+CO_Status ExecuteSweep(void);
+CO_Status ExecutePipeline(void);
+CO_Status ExecuteEncoders(void);
+CO_Status ExecuteBufferScaling(void);
 void SetupExecuteTest(void);
-
-//Struct to hold elapse time in millisecond
+static void Test_Begin(void);
+static CO_Status RunTest(void);
+static CO_Status RunSweep(void);
+static void Idle_Report(void *arg);
+static bool Main_Pending(void *arg);
+static bool SendHexFrameZeroCopy(const uint8_t *data, unsigned len);
+
+//Struct to hold elapse time in TIMING ticks, see TIMING_TickHz
 typedef struct {
-	uint32_t start;
-	uint32_t elapse;
-}Time_Elapse_Millis;
+	uint64_t start;
+	uint64_t elapse;
+}Time_Elapse;
 
-Time_Elapse_Millis time_elapse;
+Time_Elapse time_elapse;
 
 //Start counting time
-void Timer_Start(Time_Elapse_Millis * t);
+void Timer_Start(Time_Elapse * t);
 
 // Stop counting time
-// calculate number of ms has passed since the Timer_Start is called
-// this number can be access via t-> elapse
-void Timer_Stop(Time_Elapse_Millis * t);
+// calculate number of ticks has passed since the Timer_Start is called
+// this number can be access via t-> elapse, TIMING_TicksToUs converts it
+void Timer_Stop(Time_Elapse * t);
 
 int main(void)
 {
     /* Initialize BDK library, set system clock (default 8MHz). */
     BDK_Initialize();
 
+    /* Start the benchmark time source, see timing.h for the backends. */
+    TIMING_Initialize();
+
+    /* Build the CRC tables used by the framed output. */
+    CRC32_Initialize();
+
+    /* Separate RTT channels for text, log records, payload and results. */
+    RTT_ChannelInitialize();
+    LOG_Initialize();
+    RTT_StagingInit(&staging, staging_buffer, sizeof(staging_buffer));
+    DISP_Init(&dispatcher);
+
+    /* Sleep until the next timer deadline instead of waking on every tick. */
+    IDLE_DeviceInitialize();
+    IDLE_Init(&idle, &IDLE_DevicePort);
+    IDLE_SetPending(&idle, &Main_Pending, NULL);
+    IDLE_TimerInit(&idle_report, &Idle_Report, NULL);
+    IDLE_TimerStart(&idle, &idle_report, (uint32_t)((uint64_t)IDLE_REPORT_MS * TIMING_TickHz() / 1000u));
+
     /* Initialize all LEDs */
     LED_Initialize(LED_RED);
     LED_Initialize(LED_GREEN);
@@ -66,30 +161,63 @@ int main(void)
     /* Initialize Button to call callback function when pressed or released. */
     BTN_Initialize(BTN0);
 
-    /* AttachScheduled -> Callback will be scheduled and called by Kernel Scheduler. */
-    /* AttachInt -> Callback will be called directly from interrupt routine. */
-    BTN_AttachScheduled(BTN_EVENT_RELEASED, &PB_TransitionEvent, (void*)BTN0, BTN0);
+    /* AttachInt -> Callback will be called directly from interrupt routine;
+     * both post to the dispatcher, which the idle check can see. */
+    BTN_AttachInt(BTN_EVENT_RELEASED, &PB_ReleasedInt, (void*)BTN0, BTN0);
+    BTN_AttachInt(BTN_EVENT_PRESSED, &PB_PressedInt, (void*)BTN0, BTN0);
 
-    printf("APP: Entering main loop.\r\n");
+    BTN_Initialize(BTN1);
+    BTN_AttachInt(BTN_EVENT_RELEASED, &PB_ReleasedInt, (void*)BTN1, BTN1);
+    BTN_AttachInt(BTN_EVENT_PRESSED, &PB_PressedInt, (void*)BTN1, BTN1);
+
+    LOG("APP: Entering main loop.\r\n");
 
     while (1)
     {
         /* Execute any events that have occurred & refresh Watchdog timer. */
         BDK_Schedule();
 
+        /* Urgent events first, they do not wait for the BDK task list */
+        DISP_Run(&dispatcher, DISP_POOL_SIZE);
+
+        /* Only the main loop writes staged messages to RTT */
+        RTT_StagingDrain(&staging, SEGGER_RTT_Write, RTT_CH_TERMINAL);
+
+        IDLE_RunExpired(&idle);
 
-        if(start_test)
+        if(start_test && !test_running && !sweep_running)
         {
         	printf("Send %d * %d bytes of data\n", SEND_LOOP, SEND_SIZE);
         	SetupTestData();
-			ExecuteTest();
-        	//SetupExecuteTest();
-        	printf("\n\nSend %d * %d bytes of data\n", SEND_LOOP, SEND_SIZE);
-			printf("\n\ntime: %lu ms\n", time_elapse.elapse);
+        	Test_Begin();
+        	test_running = true;
         	start_test = false;
         }
 
-        SYS_WAIT_FOR_INTERRUPT;
+        if(start_sweep && !test_running && !sweep_running)
+        {
+        	Bulk_PrintSeed("sweep", 0, true);
+        	SetupTestData();
+        	Test_Begin();
+        	sweep_running = true;
+        	start_sweep = false;
+        }
+
+        /* One turn per pass, so events and the watchdog are served during the test */
+        if(test_running && RunTest() == CO_DONE)
+        {
+        	test_running = false;
+        }
+
+        if(sweep_running && RunSweep() == CO_DONE)
+        {
+        	sweep_running = false;
+        }
+
+        if(!test_running && !sweep_running)
+        {
+        	IDLE_Sleep(&idle);
+        }
     }
 
     return 0;
@@ -101,73 +229,589 @@ void PB_TransitionEvent(void *arg)
 
     if(btn == BTN0)
     {
+    	RTT_StagingWrite(&staging, "BTN0 released\n", 14);
     	start_test = true;
     }
+    else if(btn == BTN1)
+    {
+    	RTT_StagingWrite(&staging, "BTN1 released\n", 14);
+    	start_sweep = true;
+    }
+}
+
+// Dispatched at PRIO_BUTTON, ahead of any other pending work
+static void Button_Pressed(void *arg)
+{
+    ButtonName btn = (ButtonName)arg;
+
+    RTT_StagingWrite(&staging, (btn == BTN0) ? "BTN0 pressed\n" : "BTN1 pressed\n", 13);
+}
+
+// Runs in the button interrupt, so it only posts the event
+void PB_PressedInt(void *arg)
+{
+    DISP_Post(&dispatcher, PRIO_BUTTON, Button_Pressed, arg);
+}
+
+// Runs in the button interrupt, PB_TransitionEvent follows in the main loop
+void PB_ReleasedInt(void *arg)
+{
+    DISP_Post(&dispatcher, PRIO_BUTTON, PB_TransitionEvent, arg);
+}
+
+// Called by IDLE_Sleep with interrupts masked: work that a pass of the main
+// loop would do keeps the core awake, anything posted later wakes the WFI
+static bool Main_Pending(void *arg)
+{
+	(void)arg;
+	return DISP_Pending(&dispatcher) || RTT_StagingPending(&staging) || start_test || start_sweep;
+}
+
+// Share of the time the core slept, reported periodically on the metrics channel
+static void Idle_Report(void *arg)
+{
+	int n = IDLE_FormatStats(bench_line, sizeof(bench_line), &idle, TIMING_TickHz());
+
+	(void)arg;
+	RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+	IDLE_TimerStart(&idle, &idle_report, (uint32_t)((uint64_t)IDLE_REPORT_MS * TIMING_TickHz() / 1000u));
+}
+
+// Each run starts with "seed,<seed>,<frames>,<repeat>,<label>" on the bulk channel
+// so captures are self-contained: Tools/rtt_verify expects <frames> plain hex
+// frames, all of the first payload if <repeat> is 1, and 0 frames means the run
+// is not checked
+void Bulk_PrintSeed(const char *label, unsigned frames, bool repeat)
+{
+	int n = snprintf(bench_line, sizeof(bench_line), "seed,%lu,%u,%u,%s\n", (unsigned long)test_seed,
+			frames, repeat ? 1u : 0u, label);
+	RTT_ChannelWrite(RTT_CH_BULK, bench_line, n);
 }
 
 void SetupTestData(void)
 {
-	for(int i = 0; i < SEND_SIZE; i++)
-	{
-		buffer_1024_Byte[i] = rand();
+	PRNG_Seed(&prng, test_seed);
+	PRNG_Fill(&prng, buffer_1024_Byte, BUFF_SIZE);
+}
+/* Output backends compared by ExecuteTest */
+static void Send_Printf(const char *frame, unsigned len)
+{
+	(void)len;
+	printf("%s", frame); // really bad performance, always goes to RTT_CH_TERMINAL
+}
+
+static void Send_RttPrintf(const char *frame, unsigned len)
+{
+	(void)len;
+	SEGGER_RTT_printf(RTT_CH_BULK, "%s", frame);
+}
+
+static void Send_RttWrite(const char *frame, unsigned len)
+{
+	SEGGER_RTT_Write(RTT_CH_BULK, frame, len);
+}
+
+/* Same write under the back-pressure policy of the channel, see rtt_channel.h */
+static void Send_ChannelWrite(const char *frame, unsigned len)
+{
+	RTT_ChannelWrite(RTT_CH_BULK, frame, len);
+}
+
+static void Send_RttWriteString(const char *frame, unsigned len)
+{
+	(void)len;
+	SEGGER_RTT_WriteString(RTT_CH_BULK, frame);
+}
+
+static void Stream_Begin(void)
+{
+	RTT_StreamInit(&stream, RTT_ChannelWrite, RTT_CH_BULK, stream_batch, STREAM_BATCH_SIZE);
+}
+
+static void Send_Stream(const char *frame, unsigned len)
+{
+	RTT_StreamWrite(&stream, frame, len);
+}
+
+static void Stream_End(void)
+{
+	RTT_StreamFlush(&stream);
+}
+
+/* Encodes the payload into the ring for every frame, so it includes the
+ * hex encoding that the other backends get for free. */
+static void Send_ZeroCopy(const char *frame, unsigned len)
+{
+	(void)frame;
+	SendHexFrameZeroCopy(buffer_1024_Byte, (len - 1) / 2);
+}
+
+/* Encode every frame before writing it, plain and with sequence number and
+ * CRC. The difference between the two is the cost of the framing; bytes
+ * are counted as the unframed frame length for both. Both write under the
+ * channel policy so their drops show in the rtt counters. */
+static void Send_HexWrite(const char *frame, unsigned len)
+{
+	unsigned size = (len - 1) / 2;
+
+	(void)frame;
+	HEX_EncodeSwar(frame_buffer_Char, buffer_1024_Byte, size, HEX_UPPER);
+	frame_buffer_Char[2*size] = '\n';
+	RTT_ChannelWrite(RTT_CH_BULK, frame_buffer_Char, len);
+}
+
+static void Framed_Begin(void)
+{
+	frame_seq = 0;
+}
+
+static void Send_Framed(const char *frame, unsigned len)
+{
+	unsigned n;
+
+	(void)frame;
+	n = FRAME_Encode(frame_buffer_Char, frame_seq++, buffer_1024_Byte, (len - 1) / 2);
+	RTT_ChannelWrite(RTT_CH_BULK, frame_buffer_Char, n);
+}
+
+/* Compressed payload, framed. Each run is announced on the bulk channel
+ * with "codec,<name>" so Tools/rtt_decompress can follow the stream, and
+ * like Send_Framed the bytes are counted as the uncompressed frame. The
+ * frames go through RTT_ChannelWrite, which writes a frame whole or not at
+ * all under the bulk channel policy; when one is dropped the encoder starts
+ * over, and the decoder does the same at the sequence gap. */
+static void Bulk_PrintCodec(const char *name)
+{
+	int n = snprintf(bench_line, sizeof(bench_line), "codec,%s\n", name);
+	RTT_ChannelWrite(RTT_CH_BULK, bench_line, n);
+}
+
+static void Lz_Begin(void)
+{
+	COMP_LzEncoderInit(&lz_encoder);
+	frame_seq = 0;
+	Bulk_PrintCodec("lz");
+}
+
+static void Send_Lz(const char *frame, unsigned len)
+{
+	unsigned n;
+
+	(void)frame;
+	n = COMP_LzEncode(&lz_encoder, comp_buffer, buffer_1024_Byte, (len - 1) / 2);
+	n = FRAME_Encode(frame_buffer_Char, frame_seq++, comp_buffer, n);
+	if (RTT_ChannelWrite(RTT_CH_BULK, frame_buffer_Char, n) != n) {
+		COMP_LzEncoderInit(&lz_encoder);
 	}
 }
-void ExecuteTest(void)
+
+static void Rle_Begin(void)
 {
-	char *hexchar;
-	for(int j = 0; j < SEND_SIZE; j++) {
-		hexchar = send_buffer_Char + 2*j;
-		*hexchar = (buffer_1024_Byte[j] >> 4);
-		*hexchar += '0';
-		if (*hexchar > '9') {
-			*hexchar += 7;
-		}
-		hexchar ++;
-		*hexchar = (buffer_1024_Byte[j] & 0x0f);
-		*hexchar += '0';
-		if (*hexchar > '9') {
-			*hexchar += 7;
+	COMP_RleInit(&rle_encoder);
+	frame_seq = 0;
+	Bulk_PrintCodec("rle");
+}
+
+static void Send_Rle(const char *frame, unsigned len)
+{
+	unsigned n;
+
+	(void)frame;
+	n = COMP_RleEncode(&rle_encoder, comp_buffer, buffer_1024_Byte, (len - 1) / 2);
+	n = FRAME_Encode(frame_buffer_Char, frame_seq++, comp_buffer, n);
+	if (RTT_ChannelWrite(RTT_CH_BULK, frame_buffer_Char, n) != n) {
+		COMP_RleInit(&rle_encoder);
+	}
+}
+
+static void Codec_End(void)
+{
+	Bulk_PrintCodec("none");
+}
+
+static const BENCH_Backend bench_backends[] = {
+	{ "printf", NULL, Send_Printf, NULL },
+	{ "SEGGER_RTT_printf", NULL, Send_RttPrintf, NULL },
+	{ "SEGGER_RTT_Write", NULL, Send_RttWrite, NULL },
+	{ "RTT_ChannelWrite", NULL, Send_ChannelWrite, NULL },
+	{ "SEGGER_RTT_WriteString", NULL, Send_RttWriteString, NULL },
+	{ "RTT_StreamWrite", Stream_Begin, Send_Stream, Stream_End },
+	{ "RTT_Reserve+HEX_EncodeSwar", NULL, Send_ZeroCopy, NULL },
+	{ "HEX_EncodeSwar+RTT_ChannelWrite", NULL, Send_HexWrite, NULL },
+	{ "FRAME_Encode+RTT_ChannelWrite", Framed_Begin, Send_Framed, NULL },
+	{ "COMP_LzEncode+FRAME_Encode", Lz_Begin, Send_Lz, Codec_End },
+	{ "COMP_RleEncode+FRAME_Encode", Rle_Begin, Send_Rle, Codec_End },
+};
+
+#define BENCH_BACKEND_COUNT (sizeof(bench_backends) / sizeof(bench_backends[0]))
+
+/* Only the backends writing through RTT_ChannelWrite update the bulk channel
+ * counters; the others would report zeros whatever they lost. */
+static bool Bench_CountsChannel(const char *name)
+{
+	for (unsigned b = 0; b < BENCH_BACKEND_COUNT; b++) {
+		if (bench_backends[b].name == name) {
+			void (*send)(const char *, unsigned) = bench_backends[b].send;
+
+			return send == Send_ChannelWrite || send == Send_Stream ||
+					send == Send_HexWrite || send == Send_Framed ||
+					send == Send_Lz || send == Send_Rle;
 		}
 	}
+	return false;
+}
+
+BENCH_Result bench_results[BENCH_BACKEND_COUNT];
+RTT_ChannelStats bench_channel[BENCH_BACKEND_COUNT];
+LAT_Histogram send_latency;
+BENCH_Clock test_clock;
+BENCH_Job test_job;         // measurement of the running test
+CO_Slice test_slice;
+unsigned test_backend;
+
+/* Clock and turn length of the test about to start, RunTest or RunSweep */
+static void Test_Begin(void)
+{
+	CO_INIT(&run_co);
+	test_clock = (BENCH_Clock){ TIMING_Now, TIMING_TickHz(), SystemCoreClock };
+	CO_SliceInit(&test_slice, TIMING_Now, test_yield_frames,
+			(uint32_t)((uint64_t)test_yield_us * test_clock.tick_hz / 1000000u));
+}
+
+/* BTN0: the backends, then the pipeline and the encodings */
+static CO_Status RunTest(void)
+{
+	CO_BEGIN(&run_co);
+
+	CO_INIT(&test_co);
+	CO_AWAIT(&run_co, ExecuteTest());
+	CO_AWAIT(&run_co, ExecutePipeline());
+	CO_AWAIT(&run_co, ExecuteEncoders());
+	//SetupExecuteTest();
+	//printf("\n\ntime: %lu us\n", (uint32_t)TIMING_TicksToUs(time_elapse.elapse));
+
+	CO_END(&run_co);
+}
+
+/* BTN1: the sweep over all backends, then the up-buffer sizes */
+static CO_Status RunSweep(void)
+{
+	CO_BEGIN(&run_co);
+
+	CO_AWAIT(&run_co, ExecuteSweep());
+	CO_AWAIT(&run_co, ExecuteBufferScaling());
+
+	CO_END(&run_co);
+}
+
+/* Coroutine, each call sends one turn of frames; restart with CO_INIT(&test_co) */
+CO_Status ExecuteTest(void)
+{
+	unsigned b;
+	int n;
+
+	CO_BEGIN(&test_co);
+
+	HEX_EncodeSwar(send_buffer_Char, buffer_1024_Byte, SEND_SIZE, HEX_UPPER);
 	send_buffer_Char[2*SEND_SIZE] = '\n';
 	send_buffer_Char[2*SEND_SIZE+1] = 0;
 
-	Timer_Start(&time_elapse);
-	for (int i = 0; i < SEND_LOOP; i++) {
-		//printf(send_buffer_Char); // really bad performance
-		SEGGER_RTT_printf(0, "%s", send_buffer_Char);
-		//SEGGER_RTT_Write(0, send_buffer_Char, 30);
-		//SEGGER_RTT_WriteString(0, send_buffer_Char);
+	for (test_backend = 0; test_backend < BENCH_BACKEND_COUNT; test_backend++) {
+		Bulk_PrintSeed(bench_backends[test_backend].name, SEND_LOOP, true);
+		LAT_Reset(&send_latency);
+		RTT_ChannelResetStats(RTT_CH_BULK);
+		BENCH_JobInit(&test_job, &bench_backends[test_backend], &test_clock, send_buffer_Char,
+				2*SEND_SIZE + 1, SEND_LOOP, &bench_results[test_backend], &send_latency);
+		CO_AWAIT(&test_co, BENCH_JobRun(&test_job, &test_slice));
+
+		bench_channel[test_backend] = *RTT_ChannelGetStats(RTT_CH_BULK);
+
+		/* Per call jitter of this backend, reported before the next run starts */
+		n = LAT_FormatSummary(bench_line, sizeof(bench_line), bench_backends[test_backend].name,
+				&send_latency, test_clock.tick_hz);
+		RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+		for (unsigned i = 0; i < LAT_BUCKET_COUNT; i++) {
+			n = LAT_FormatBucket(bench_line, sizeof(bench_line), bench_backends[test_backend].name,
+					&send_latency, i, test_clock.tick_hz);
+			RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+		}
 	}
-	Timer_Stop(&time_elapse);
+
+	/* Report all results together so the table is not interleaved with payload */
+	n = BENCH_FormatHeader(bench_line, sizeof(bench_line));
+	RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+	for (b = 0; b < BENCH_BACKEND_COUNT; b++) {
+		n = BENCH_FormatRow(bench_line, sizeof(bench_line), &bench_results[b]);
+		RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+
+		/* What the bulk channel policy wrote, dropped and stalled during the run */
+		if (Bench_CountsChannel(bench_results[b].backend)) {
+			n = RTT_ChannelFormatStats(bench_line, sizeof(bench_line), bench_results[b].backend,
+					&bench_channel[b]);
+			RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+		}
+	}
+
+	CO_END(&test_co);
+}
+
+static unsigned Sweep_Prepare(unsigned size, const char **frame)
+{
+	if (size > BUFF_SIZE) {
+		size = BUFF_SIZE;
+	}
+
+	HEX_EncodeSwar(send_buffer_Char, buffer_1024_Byte, size, HEX_UPPER);
+	send_buffer_Char[2*size] = '\n';
+	send_buffer_Char[2*size+1] = 0;
+
+	*frame = send_buffer_Char;
+	return 2*size + 1;
+}
+
+/* Each point of a counting backend is followed by what the bulk channel
+ * dropped and stalled during it */
+static void Sweep_Emit(const BENCH_Result *result)
+{
+	int n = BENCH_FormatRow(bench_line, sizeof(bench_line), result);
+	RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+
+	if (Bench_CountsChannel(result->backend)) {
+		n = RTT_ChannelFormatStats(bench_line, sizeof(bench_line), result->backend,
+				RTT_ChannelGetStats(RTT_CH_BULK));
+		RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+	}
+	RTT_ChannelResetStats(RTT_CH_BULK);
+}
+
+BENCH_SweepConfig sweep_points;     // sweep_config as measured
+BENCH_SweepJob sweep_job;
+CO_State sweep_co;
+
+/* Coroutine, each call measures one turn of a point and yields after each point */
+CO_Status ExecuteSweep(void)
+{
+	unsigned max_size;
+	int n;
+
+	CO_BEGIN(&sweep_co);
+
+	/* A frame of 2 * size + 1 characters must fit the ring, which keeps one byte free */
+	sweep_points = sweep_config;
+	max_size = (_SEGGER_RTT.aUp[RTT_CH_BULK].SizeOfBuffer - 2) / 2;
+	if (sweep_points.size.last > max_size) {
+		sweep_points.size.last = max_size;
+	}
+
+	n = BENCH_FormatHeader(bench_line, sizeof(bench_line));
+	RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+	RTT_ChannelResetStats(RTT_CH_BULK);
+	BENCH_SweepJobInit(&sweep_job, bench_backends, BENCH_BACKEND_COUNT, &test_clock, &sweep_points,
+			Sweep_Prepare, Sweep_Emit);
+	CO_AWAIT(&sweep_co, BENCH_SweepJobRun(&sweep_job, &test_slice));
+
+	CO_END(&sweep_co);
+}
+
+/* Generate and encode the next frame of a pipeline run */
+static unsigned Pipe_Produce(char *buf, void *arg)
+{
+	(void)arg;
+	if (pipe_frames_left == 0) {
+		return 0;
+	}
+	pipe_frames_left--;
+
+	PRNG_Fill(&prng, buffer_1024_Byte, SEND_SIZE);
+	HEX_EncodeSwar(buf, buffer_1024_Byte, SEND_SIZE, HEX_UPPER);
+	buf[2*SEND_SIZE] = '\n';
+	return 2*SEND_SIZE + 1;
+}
+
+Time_Elapse pipe_serial;
+Time_Elapse pipe_pipelined;
+uint32_t pipe_serial_full;
+uint32_t pipe_serial_dropped;
+CO_State pipe_co;
+
+/* Same frames serial and ping-pong, reported as
+ * "pipe,frames,bytes,serial_us,pipelined_us,saved_us,saved_permille,serial_full,pipelined_full,
+ * serial_dropped,pipelined_dropped". Coroutine, both passes yield after every
+ * step so other events still run and the times include the same overhead. */
+CO_Status ExecutePipeline(void)
+{
+	uint64_t serial_us;
+	uint64_t pipelined_us;
+	int64_t saved_us;
+	int n;
+
+	CO_BEGIN(&pipe_co);
+
+	PIPE_Init(&pipe, RTT_CH_BULK, pipe_buffer[0], pipe_buffer[1], Pipe_Produce, NULL);
+	PIPE_SetTimeout(&pipe, TIMING_Now, (uint32_t)((uint64_t)PIPE_TIMEOUT_US * TIMING_TickHz() / 1000000u));
+
+	Bulk_PrintSeed("pipe_serial", SEND_LOOP, false);
+	PRNG_Seed(&prng, test_seed);
+	pipe_frames_left = SEND_LOOP;
+	PIPE_Start(&pipe);
+	Timer_Start(&pipe_serial);
+	while (PIPE_PollSerial(&pipe)) {
+		CO_YIELD(&pipe_co);
+	}
+	Timer_Stop(&pipe_serial);
+	pipe_serial_full = pipe.full_polls;
+	pipe_serial_dropped = pipe.dropped;
+
+	Bulk_PrintSeed("pipe_pipelined", SEND_LOOP, false);
+	PRNG_Seed(&prng, test_seed);
+	pipe_frames_left = SEND_LOOP;
+	PIPE_Start(&pipe);
+	Timer_Start(&pipe_pipelined);
+	while (PIPE_Poll(&pipe)) {
+		CO_YIELD(&pipe_co);
+	}
+	Timer_Stop(&pipe_pipelined);
+
+	serial_us = TIMING_TicksToUs(pipe_serial.elapse);
+	pipelined_us = TIMING_TicksToUs(pipe_pipelined.elapse);
+	saved_us = (int64_t)serial_us - (int64_t)pipelined_us;
+	n = snprintf(bench_line, sizeof(bench_line), "pipe,%lu,%lu,%lu,%lu,%ld,%ld,%lu,%lu,%lu,%lu\n",
+			(unsigned long)pipe.frames, (unsigned long)pipe.bytes,
+			(unsigned long)serial_us, (unsigned long)pipelined_us,
+			(long)saved_us, (long)(serial_us ? saved_us * 1000 / (int64_t)serial_us : 0),
+			(unsigned long)pipe_serial_full, (unsigned long)pipe.full_polls,
+			(unsigned long)pipe_serial_dropped, (unsigned long)pipe.dropped);
+	RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+
+	CO_END(&pipe_co);
+}
+
+/* Payload encodings compared by ExecuteEncoders, len is the payload size */
+static const WIRE_Encoder *const wire_encoders[] = {
+	&WIRE_Hex, &WIRE_Base64, &WIRE_Base85, &WIRE_Cobs,
+};
+static const WIRE_Encoder *wire_current;
+static unsigned wire_frame_len;
+unsigned wire_index;
+BENCH_Result wire_encode;
+BENCH_Result wire_send;
+CO_State wire_co;
+
+static void Wire_Encode(const char *frame, unsigned len)
+{
+	(void)frame;
+	wire_frame_len = WIRE_EncodeFrame(wire_current, frame_buffer_Char, buffer_1024_Byte, len);
+}
+
+static void Wire_Send(const char *frame, unsigned len)
+{
+	unsigned n;
+
+	(void)frame;
+	n = WIRE_EncodeFrame(wire_current, frame_buffer_Char, buffer_1024_Byte, len);
+	RTT_ChannelWrite(RTT_CH_BULK, frame_buffer_Char, n);
+}
+
+static const BENCH_Backend wire_encode_only = { "encode", NULL, Wire_Encode, NULL };
+static const BENCH_Backend wire_encode_send = { "send", NULL, Wire_Send, NULL };
+
+/* Wire bytes and device cost of each encoding for one SEND_SIZE payload, as
+ * "wire,encoder,payload,frame,expansion_permille,encode_cpb,send_cpb" with
+ * cycles per payload byte for encoding alone and for encoding plus write.
+ * Coroutine, each call runs one turn of frames. */
+CO_Status ExecuteEncoders(void)
+{
+	int n;
+
+	CO_BEGIN(&wire_co);
+
+	/* The pipeline runs left other data in the payload buffer */
+	SetupTestData();
+
+	for (wire_index = 0; wire_index < sizeof(wire_encoders) / sizeof(wire_encoders[0]); wire_index++) {
+		wire_current = wire_encoders[wire_index];
+		/* Only the hex frames can be checked by rtt_verify */
+		Bulk_PrintSeed(wire_current->name, (wire_current == &WIRE_Hex) ? SEND_LOOP : 0, true);
+		BENCH_JobInit(&test_job, &wire_encode_only, &test_clock, send_buffer_Char, SEND_SIZE,
+				SEND_LOOP, &wire_encode, NULL);
+		CO_AWAIT(&wire_co, BENCH_JobRun(&test_job, &test_slice));
+		BENCH_JobInit(&test_job, &wire_encode_send, &test_clock, send_buffer_Char, SEND_SIZE,
+				SEND_LOOP, &wire_send, NULL);
+		CO_AWAIT(&wire_co, BENCH_JobRun(&test_job, &test_slice));
+
+		n = snprintf(bench_line, sizeof(bench_line), "wire,%s,%u,%u,%u,%lu.%02lu,%lu.%02lu\n",
+				wire_current->name, SEND_SIZE, wire_frame_len, wire_frame_len * 1000 / SEND_SIZE,
+				(unsigned long)(wire_encode.cycles_per_byte_x100 / 100),
+				(unsigned long)(wire_encode.cycles_per_byte_x100 % 100),
+				(unsigned long)(wire_send.cycles_per_byte_x100 / 100),
+				(unsigned long)(wire_send.cycles_per_byte_x100 % 100));
+		RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+	}
+
+	CO_END(&wire_co);
+}
+
+static const BENCH_Backend rtbuf_backend = { "RTT_ChannelWrite", NULL, Send_ChannelWrite, NULL };
+unsigned rtbuf_capacity;
+unsigned rtbuf_size;
+const char *rtbuf_frame;
+unsigned rtbuf_len;
+BENCH_Result rtbuf_result;
+CO_State rtbuf_co;
+
+/* Throughput of the bulk channel policy for growing up-buffer sizes, from 1 KB
+ * to the whole buffer, as "rtbuf,size,bytes,us,bytes_per_s,dropped,stalls,stall_us".
+ * Coroutine, each call runs one turn of frames. */
+CO_Status ExecuteBufferScaling(void)
+{
+	const RTT_ChannelStats *stats = RTT_ChannelGetStats(RTT_CH_BULK);
+	int n;
+
+	CO_BEGIN(&rtbuf_co);
+
+	rtbuf_capacity = RTT_ChannelCapacity(RTT_CH_BULK);
+	rtbuf_len = Sweep_Prepare(SEND_SIZE, &rtbuf_frame);
+	rtbuf_size = 1024;
+
+	while (rtbuf_size > 0) {
+		if (rtbuf_size > rtbuf_capacity) {
+			rtbuf_size = rtbuf_capacity;
+		}
+		if (RTT_ChannelResize(RTT_CH_BULK, rtbuf_size) != rtbuf_size) {
+			break;
+		}
+
+		RTT_ChannelResetStats(RTT_CH_BULK);
+		BENCH_JobInit(&test_job, &rtbuf_backend, &test_clock, rtbuf_frame, rtbuf_len, SEND_LOOP,
+				&rtbuf_result, NULL);
+		CO_AWAIT(&rtbuf_co, BENCH_JobRun(&test_job, &test_slice));
+		n = snprintf(bench_line, sizeof(bench_line), "rtbuf,%u,%lu,%lu,%lu,%lu,%lu,%lu\n",
+				rtbuf_size, (unsigned long)rtbuf_result.bytes, (unsigned long)rtbuf_result.us,
+				(unsigned long)rtbuf_result.bytes_per_s, (unsigned long)stats->dropped,
+				(unsigned long)stats->stalls,
+				(unsigned long)TIMING_TicksToUs(stats->stall_ticks));
+		RTT_ChannelWrite(RTT_CH_METRICS, bench_line, n);
+
+		rtbuf_size = (rtbuf_size < rtbuf_capacity) ? 2 * rtbuf_size : 0;
+	}
+
+	/* Leave the channel with its full buffer for the next test */
+	RTT_ChannelResize(RTT_CH_BULK, rtbuf_capacity);
+
+	CO_END(&rtbuf_co);
 }
 
 void SetupExecuteTest(void)
 {
-	char *hexchar;
+	PRNG_Seed(&prng, test_seed);
 	Timer_Start(&time_elapse);
 	for (int i = 0; i < SEND_LOOP; i++) {
-		for(int j = 0; j < SEND_SIZE; j++) {
-			buffer_1024_Byte[j] = rand();
-		}
-		for(int j = 0; j < SEND_SIZE; j++) {
-			hexchar = send_buffer_Char + 2*j;
-			*hexchar = (buffer_1024_Byte[j] >> 4);
-			*hexchar += '0';
-			if (*hexchar > '9') {
-				*hexchar += 7;
-			}
-			hexchar ++;
-			*hexchar = (buffer_1024_Byte[j] & 0x0f);
-			*hexchar += '0';
-			if (*hexchar > '9') {
-				*hexchar += 7;
-			}
-		}
+		PRNG_Fill(&prng, buffer_1024_Byte, SEND_SIZE);
+		HEX_Encode(send_buffer_Char, buffer_1024_Byte, SEND_SIZE);
 		send_buffer_Char[2*SEND_SIZE] = '\n';
 		send_buffer_Char[2*SEND_SIZE+1] = 0;
 
-		printf(send_buffer_Char);
+		printf("%s", send_buffer_Char);
 		//SEGGER_RTT_printf(0, "%s", send_buffer_Char);
 		//SEGGER_RTT_Write(0, send_buffer_Char, 30);
 		//SEGGER_RTT_WriteString(0, send_buffer_Char);
@@ -175,24 +819,41 @@ void SetupExecuteTest(void)
 	Timer_Stop(&time_elapse);
 }
 
-
-/*Code for counting time*/
-void Timer_Start(Time_Elapse_Millis * t)
+/* Hex encode one frame straight into the RTT_CH_BULK up-buffer and publish it with a
+ * single write index update. Returns false if the frame was dropped. */
+static bool SendHexFrameZeroCopy(const uint8_t *data, unsigned len)
 {
+	RTT_Span span;
+	unsigned frame = HEX_ENCODED_SIZE(len) + 1;
 
-#ifdef USING_SW_TIMER
-#error not implemeneted
-#else
-	t->start = HAL_Time();
-#endif
+	/* One byte of the ring always stays free, a larger frame would never fit */
+	if (!RTT_ReserveFits(&_SEGGER_RTT.aUp[RTT_CH_BULK], frame))
+	{
+		return false;
+	}
+
+	while (RTT_Reserve(RTT_CH_BULK, frame, &span) < frame)
+	{
+		/* Same behaviour as SEGGER_RTT_Write for the configured channel mode */
+		if ((_SEGGER_RTT.aUp[RTT_CH_BULK].Flags & SEGGER_RTT_MODE_MASK) != SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL)
+		{
+			return false;
+		}
+	}
+
+	RTT_SpanWriteHex(&span, 0, data, len);
+	RTT_SpanWrite(&span, frame - 1, "\n", 1);
+	RTT_Commit(RTT_CH_BULK, frame);
+	return true;
 }
 
-void Timer_Stop(Time_Elapse_Millis * t)
+/*Code for counting time*/
+void Timer_Start(Time_Elapse * t)
 {
-#ifdef USING_SW_TIMER
-#error not implemeneted
-#else
-	t->elapse = HAL_Time() - t->start;
-#endif
+	t->start = TIMING_Now64();
 }
 
+void Timer_Stop(Time_Elapse * t)
+{
+	t->elapse = TIMING_Now64() - t->start;
+}
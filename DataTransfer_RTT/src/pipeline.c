@@ -0,0 +1,183 @@
+//-----------------------------------------------------------------------------
+//! \file pipeline.c
+//!
+//! Double-buffered (ping-pong) producer for RTT output.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#include "pipeline.h"
+#include "rtt_reserve.h"
+
+/* Hand the buffer in flight back to the producer */
+static void PIPE_Release(PIPE_Pipeline *p)
+{
+	p->len[p->drain] = 0;
+	p->drain ^= 1;
+	p->sent = 0;
+	p->stalled = false;
+}
+
+/* The ring had no room: drop the frame once the stall exceeds the timeout */
+static bool PIPE_Stall(PIPE_Pipeline *p)
+{
+	uint32_t now;
+
+	p->full_polls++;
+	if (p->now == NULL)
+	{
+		return false;
+	}
+
+	now = p->now();
+	if (!p->stalled)
+	{
+		p->stalled = true;
+		p->stall_start = now;
+		return false;
+	}
+	if (now - p->stall_start < p->timeout_ticks)
+	{
+		return false;
+	}
+
+	p->dropped++;
+	p->dropped_bytes += p->len[p->drain] - p->sent;
+	p->cut = p->cut || p->sent > 0;
+	PIPE_Release(p);
+	return true;
+}
+
+/* Write what fits of the frame in flight, true once it is complete or dropped */
+static bool PIPE_DrainStep(PIPE_Pipeline *p)
+{
+	unsigned left = p->len[p->drain] - p->sent;
+	RTT_Span span;
+	unsigned n;
+
+	/* End the line of a dropped frame before the next one starts */
+	if (p->cut)
+	{
+		if (RTT_Reserve(p->channel, 1, &span) == 0)
+		{
+			return PIPE_Stall(p);
+		}
+		RTT_SpanWrite(&span, 0, "\n", 1);
+		RTT_Commit(p->channel, 1);
+		p->cut = false;
+	}
+
+	n = RTT_Reserve(p->channel, left, &span);
+	if (n == 0)
+	{
+		return PIPE_Stall(p);
+	}
+
+	RTT_SpanWrite(&span, 0, p->buf[p->drain] + p->sent, n);
+	RTT_Commit(p->channel, n);
+	p->sent += n;
+	p->bytes += n;
+	p->stalled = false;
+
+	if (n < left)
+	{
+		return false;
+	}
+
+	/* Frame is in the ring */
+	PIPE_Release(p);
+	p->frames++;
+	return true;
+}
+
+void PIPE_Init(PIPE_Pipeline *p, unsigned channel, char *buf0, char *buf1,
+		PIPE_ProduceFunc produce, void *arg)
+{
+	p->buf[0] = buf0;
+	p->buf[1] = buf1;
+	p->channel = channel;
+	p->produce = produce;
+	p->arg = arg;
+	p->now = NULL;
+	p->timeout_ticks = 0;
+	PIPE_Start(p);
+}
+
+void PIPE_SetTimeout(PIPE_Pipeline *p, uint32_t (*now)(void), uint32_t timeout_ticks)
+{
+	p->now = now;
+	p->timeout_ticks = timeout_ticks;
+}
+
+void PIPE_Start(PIPE_Pipeline *p)
+{
+	p->len[0] = 0;
+	p->len[1] = 0;
+	p->fill = 0;
+	p->drain = 0;
+	p->sent = 0;
+	p->done = false;
+	p->cut = false;
+	p->stalled = false;
+	p->frames = 0;
+	p->bytes = 0;
+	p->full_polls = 0;
+	p->dropped = 0;
+	p->dropped_bytes = 0;
+}
+
+bool PIPE_Poll(PIPE_Pipeline *p)
+{
+	if (p->len[p->drain] > 0)
+	{
+		PIPE_DrainStep(p);
+	}
+
+	/* Produce into the free buffer while the other one is still in flight */
+	if (!p->done && p->len[p->fill] == 0)
+	{
+		unsigned len = p->produce(p->buf[p->fill], p->arg);
+
+		if (len == 0)
+		{
+			p->done = true;
+		}
+		else
+		{
+			p->len[p->fill] = len;
+			p->fill ^= 1;
+		}
+	}
+
+	return !p->done || p->len[p->drain] > 0;
+}
+
+bool PIPE_PollSerial(PIPE_Pipeline *p)
+{
+	if (!p->done && p->len[0] == 0)
+	{
+		unsigned len = p->produce(p->buf[0], p->arg);
+
+		if (len == 0)
+		{
+			p->done = true;
+		}
+		else
+		{
+			p->len[0] = len;
+		}
+	}
+
+	if (p->len[0] > 0 && PIPE_DrainStep(p))
+	{
+		p->drain = 0;
+	}
+
+	return !p->done || p->len[0] > 0;
+}
+
+void PIPE_RunSerial(PIPE_Pipeline *p)
+{
+	PIPE_Start(p);
+	while (PIPE_PollSerial(p))
+	{
+	}
+}
@@ -0,0 +1,35 @@
+//-----------------------------------------------------------------------------
+//! \file prng.c
+//!
+//! Seeded xorshift32 generator for benchmark payloads.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "prng.h"
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#error prng.c assumes a little endian target
+#endif
+
+void PRNG_Seed(PRNG_State *s, uint32_t seed)
+{
+	s->state = (seed != 0) ? seed : PRNG_ZERO_SEED;
+}
+
+void PRNG_Fill(PRNG_State *s, uint8_t *buf, size_t len)
+{
+	uint32_t x;
+
+	while (len >= 4)
+	{
+		x = PRNG_Next(s);
+		memcpy(buf, &x, 4);
+		buf += 4;
+		len -= 4;
+	}
+
+	if (len > 0)
+	{
+		x = PRNG_Next(s);
+		memcpy(buf, &x, len);
+	}
+}
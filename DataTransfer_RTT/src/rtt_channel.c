@@ -0,0 +1,301 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_channel.c
+//!
+//! RTT up-buffer allocation and routing of the output streams.
+//-----------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "SEGGER_RTT.h"
+#include "rtt_channel.h"
+#include "timing.h"
+
+#if SEGGER_RTT_MAX_NUM_UP_BUFFERS < RTT_CH_COUNT
+#error SEGGER_RTT_MAX_NUM_UP_BUFFERS is too small for the RTT channel table
+#endif
+
+#define RTT_METRICS_BUFFER_SIZE    1024
+#define RTT_BULK_TIMEOUT_US        10000
+#define RTT_RESIZE_TIMEOUT_US      1000000
+
+#if RTT_BUFFER_RAM == RTT_RAM_DSP
+#define RTT_BUFFER_SECTION         __attribute__((section(".dram_dsp")))
+#elif RTT_BUFFER_RAM == RTT_RAM_BB
+#define RTT_BUFFER_SECTION         __attribute__((section(".dram_bb")))
+#else
+#define RTT_BUFFER_SECTION
+#endif
+
+/* Longest "rtt,degraded,..." line */
+#define RTT_SUMMARY_LINE_SIZE      40
+
+static char rtt_bulk_buffer[RTT_BULK_BUFFER_SIZE] RTT_BUFFER_SECTION;
+static char rtt_metrics_buffer[RTT_METRICS_BUFFER_SIZE] RTT_BUFFER_SECTION;
+
+static const RTT_ChannelConfig rtt_channels[] = {
+	{ RTT_CH_TERMINAL, "Terminal", NULL, 0, RTT_POLICY_SKIP, 0 },
+	{ RTT_CH_BULK, "Bulk", rtt_bulk_buffer, sizeof(rtt_bulk_buffer),
+			RTT_POLICY_BLOCK_TIMEOUT, RTT_BULK_TIMEOUT_US },
+	{ RTT_CH_METRICS, "Metrics", rtt_metrics_buffer, sizeof(rtt_metrics_buffer),
+			RTT_POLICY_SUMMARY, 0 },
+};
+
+/* Runtime state of a channel, all zero is RTT_POLICY_SKIP */
+typedef struct {
+	RTT_Policy policy;
+	uint32_t timeout_ticks;
+	uint32_t summary_writes;    /* Writes dropped since the last summary */
+	uint32_t summary_bytes;
+	RTT_ChannelStats stats;
+} RTT_ChannelState;
+
+static RTT_ChannelState rtt_state[RTT_CH_COUNT];
+
+static unsigned RTT_PolicyFlags(RTT_Policy policy)
+{
+	switch (policy)
+	{
+	case RTT_POLICY_TRIM:
+		return SEGGER_RTT_MODE_NO_BLOCK_TRIM;
+	case RTT_POLICY_BLOCK:
+		return SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL;
+	default:
+		/* The policies of RTT_ChannelWrite only write what fits */
+		return SEGGER_RTT_MODE_NO_BLOCK_SKIP;
+	}
+}
+
+static const RTT_ChannelConfig *RTT_ChannelFind(unsigned channel)
+{
+	for (unsigned i = 0; i < sizeof(rtt_channels) / sizeof(rtt_channels[0]); i++)
+	{
+		if (rtt_channels[i].index == channel)
+		{
+			return &rtt_channels[i];
+		}
+	}
+	return NULL;
+}
+
+/* Free bytes in the ring, one byte always stays unused */
+static unsigned RTT_ChannelFree(unsigned channel)
+{
+	const SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[channel];
+	unsigned rd = up->RdOff;
+	unsigned wr = up->WrOff;
+
+	return (rd > wr) ? rd - wr - 1 : up->SizeOfBuffer - 1 - (wr - rd);
+}
+
+/* Wait until len bytes are free or the timeout expired */
+static bool RTT_ChannelWait(RTT_ChannelState *c, unsigned channel, unsigned len)
+{
+	uint32_t start = TIMING_Now();
+	uint32_t waited = 0;
+	bool room;
+
+	while (!(room = RTT_ChannelFree(channel) >= len) && waited < c->timeout_ticks)
+	{
+		waited = TIMING_Now() - start;
+	}
+
+	c->stats.stall_ticks += waited;
+	return room;
+}
+
+/* Move the read index forward as if the host had read len bytes */
+static void RTT_ChannelDiscard(unsigned channel, unsigned len)
+{
+	SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[channel];
+	unsigned rd = up->RdOff + len;
+
+	if (rd >= up->SizeOfBuffer)
+	{
+		rd -= up->SizeOfBuffer;
+	}
+	up->RdOff = rd;
+}
+
+/* Write the drop summary if it fits in front of len bytes of data */
+static bool RTT_ChannelSummary(RTT_ChannelState *c, unsigned channel, unsigned len)
+{
+	char line[RTT_SUMMARY_LINE_SIZE];
+	int n;
+
+	if (c->summary_writes == 0)
+	{
+		return true;
+	}
+
+	n = snprintf(line, sizeof(line), "rtt,degraded,%lu,%lu\n",
+			(unsigned long)c->summary_writes, (unsigned long)c->summary_bytes);
+	if (RTT_ChannelFree(channel) < (unsigned)n + len)
+	{
+		return false;
+	}
+
+	SEGGER_RTT_Write(channel, line, n);
+	c->summary_writes = 0;
+	c->summary_bytes = 0;
+	return true;
+}
+
+void RTT_ChannelInitialize(void)
+{
+	for (unsigned i = 0; i < sizeof(rtt_channels) / sizeof(rtt_channels[0]); i++)
+	{
+		const RTT_ChannelConfig *c = &rtt_channels[i];
+
+		rtt_state[c->index].policy = c->policy;
+		RTT_ChannelSetTimeout(c->index, c->timeout_us);
+		if (c->buffer)
+		{
+			SEGGER_RTT_ConfigUpBuffer(c->index, c->name, c->buffer, c->size,
+					RTT_PolicyFlags(c->policy));
+		}
+		else
+		{
+			RTT_ChannelSetPolicy(c->index, c->policy);
+		}
+	}
+}
+
+void RTT_ChannelSetPolicy(unsigned channel, RTT_Policy policy)
+{
+	rtt_state[channel].policy = policy;
+	SEGGER_RTT_SetFlagsUpBuffer(channel, RTT_PolicyFlags(policy));
+}
+
+void RTT_ChannelSetTimeout(unsigned channel, uint32_t timeout_us)
+{
+	rtt_state[channel].timeout_ticks =
+			(uint32_t)((uint64_t)timeout_us * TIMING_TickHz() / 1000000u);
+}
+
+unsigned RTT_ChannelCapacity(unsigned channel)
+{
+	const RTT_ChannelConfig *c = RTT_ChannelFind(channel);
+
+	return (c && c->buffer) ? c->size : 0;
+}
+
+unsigned RTT_ChannelResize(unsigned channel, unsigned size)
+{
+	const RTT_ChannelConfig *c = RTT_ChannelFind(channel);
+	const SEGGER_RTT_BUFFER_UP *up = &_SEGGER_RTT.aUp[channel];
+	uint32_t timeout = (uint32_t)((uint64_t)RTT_RESIZE_TIMEOUT_US * TIMING_TickHz() / 1000000u);
+	uint32_t start = TIMING_Now();
+
+	if (c == NULL || c->buffer == NULL)
+	{
+		return 0;
+	}
+	if (size > c->size)
+	{
+		size = c->size;
+	}
+
+	/* Reconfiguring resets the indexes, data still in the ring would be lost */
+	while (up->RdOff != up->WrOff)
+	{
+		if (TIMING_Now() - start > timeout)
+		{
+			return 0;
+		}
+	}
+
+	SEGGER_RTT_ConfigUpBuffer(channel, c->name, c->buffer, size,
+			RTT_PolicyFlags(rtt_state[channel].policy));
+	return size;
+}
+
+unsigned RTT_ChannelWrite(unsigned channel, const void *data, unsigned len)
+{
+	RTT_ChannelState *c = &rtt_state[channel];
+	unsigned size = _SEGGER_RTT.aUp[channel].SizeOfBuffer;
+	unsigned avail = RTT_ChannelFree(channel);
+	unsigned n;
+
+	if (avail < len)
+	{
+		c->stats.stalls++;
+
+		switch (c->policy)
+		{
+		case RTT_POLICY_BLOCK_TIMEOUT:
+			if (!RTT_ChannelWait(c, channel, len))
+			{
+				c->stats.dropped += len;
+				return 0;
+			}
+			break;
+
+		case RTT_POLICY_DROP_OLDEST:
+			if (len >= size)
+			{
+				c->stats.dropped += len;
+				return 0;
+			}
+			RTT_ChannelDiscard(channel, len - avail);
+			c->stats.dropped += len - avail;
+			break;
+
+		case RTT_POLICY_SUMMARY:
+			c->summary_writes++;
+			c->summary_bytes += len;
+			c->stats.dropped += len;
+			return 0;
+
+		case RTT_POLICY_BLOCK:
+		{
+			uint32_t start = TIMING_Now();
+
+			n = SEGGER_RTT_Write(channel, data, len);
+			c->stats.stall_ticks += TIMING_Now() - start;
+			c->stats.written += n;
+			return n;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	if (c->policy == RTT_POLICY_SUMMARY && !RTT_ChannelSummary(c, channel, len))
+	{
+		c->summary_writes++;
+		c->summary_bytes += len;
+		c->stats.dropped += len;
+		return 0;
+	}
+
+	n = SEGGER_RTT_Write(channel, data, len);
+	c->stats.written += n;
+	c->stats.dropped += len - n;
+	return n;
+}
+
+const RTT_ChannelStats *RTT_ChannelGetStats(unsigned channel)
+{
+	return &rtt_state[channel].stats;
+}
+
+void RTT_ChannelResetStats(unsigned channel)
+{
+	RTT_ChannelStats *s = &rtt_state[channel].stats;
+
+	s->written = 0;
+	s->dropped = 0;
+	s->stalls = 0;
+	s->stall_ticks = 0;
+}
+
+int RTT_ChannelFormatStats(char *buf, unsigned size, const char *name,
+		const RTT_ChannelStats *s)
+{
+	return snprintf(buf, size, "rtt,%s,%lu,%lu,%lu,%lu\n", name,
+			(unsigned long)s->written,
+			(unsigned long)s->dropped,
+			(unsigned long)s->stalls,
+			(unsigned long)TIMING_TicksToUs(s->stall_ticks));
+}
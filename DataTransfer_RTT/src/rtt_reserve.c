@@ -0,0 +1,145 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_reserve.c
+//!
+//! Zero-copy reserve/commit access to SEGGER RTT up-buffers.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "hex_encode.h"
+#include "rtt_reserve.h"
+
+unsigned RTT_ReserveBuffer(RTT_UpBuffer *up, unsigned len, RTT_Span *span)
+{
+	unsigned wr = up->WrOff;
+	unsigned rd = up->RdOff;
+	unsigned first;
+	unsigned second;
+
+	/* One byte always stays free so that WrOff == RdOff means empty. */
+	if (rd > wr)
+	{
+		first = rd - wr - 1;
+		second = 0;
+	}
+	else
+	{
+		first = up->SizeOfBuffer - wr;
+		second = rd;
+		if (second == 0)
+		{
+			first--;
+		}
+		else
+		{
+			second--;
+		}
+	}
+
+	if (first >= len)
+	{
+		first = len;
+		second = 0;
+	}
+	else if (first + second > len)
+	{
+		second = len - first;
+	}
+
+	span->ptr[0] = up->pBuffer + wr;
+	span->len[0] = first;
+	span->ptr[1] = up->pBuffer;
+	span->len[1] = second;
+
+	return first + second;
+}
+
+bool RTT_ReserveFits(const RTT_UpBuffer *up, unsigned len)
+{
+	return len < up->SizeOfBuffer;
+}
+
+void RTT_CommitBuffer(RTT_UpBuffer *up, unsigned len)
+{
+	unsigned wr = up->WrOff + len;
+
+	if (wr >= up->SizeOfBuffer)
+	{
+		wr -= up->SizeOfBuffer;
+	}
+
+	/* Data must be in memory before the host can see the new index. */
+	__asm volatile ("" ::: "memory");
+	up->WrOff = wr;
+}
+
+void RTT_SpanWrite(const RTT_Span *span, unsigned pos, const void *data, unsigned len)
+{
+	const char *src = data;
+	unsigned n;
+
+	if (pos < span->len[0])
+	{
+		n = span->len[0] - pos;
+		if (n > len)
+		{
+			n = len;
+		}
+		memcpy(span->ptr[0] + pos, src, n);
+		src += n;
+		len -= n;
+		pos = span->len[0];
+	}
+
+	if (len > 0)
+	{
+		memcpy(span->ptr[1] + (pos - span->len[0]), src, len);
+	}
+}
+
+void RTT_SpanWriteHex(const RTT_Span *span, unsigned pos, const uint8_t *data, unsigned len)
+{
+	unsigned n = 0;
+	char pair[2];
+
+	/* Bytes that fit whole before the wrap go straight into the first span */
+	if (pos < span->len[0])
+	{
+		n = (span->len[0] - pos) / 2;
+		if (n > len)
+		{
+			n = len;
+		}
+		HEX_EncodeSwar(span->ptr[0] + pos, data, n, HEX_UPPER);
+		pos += 2*n;
+	}
+
+	if (n < len)
+	{
+		/* A byte whose two characters straddle the wrap point */
+		if (pos < span->len[0])
+		{
+			HEX_EncodeSwar(pair, &data[n], 1, HEX_UPPER);
+			RTT_SpanWrite(span, pos, pair, 2);
+			pos += 2;
+			n++;
+		}
+		HEX_EncodeSwar(span->ptr[1] + (pos - span->len[0]), &data[n], len - n, HEX_UPPER);
+	}
+}
+
+#ifndef HOST_BUILD
+unsigned RTT_Reserve(unsigned channel, unsigned len, RTT_Span *span)
+{
+	/* The control block is normally set up by the first RTT write. */
+	if (_SEGGER_RTT.acID[0] == '\0')
+	{
+		SEGGER_RTT_Init();
+	}
+
+	return RTT_ReserveBuffer(&_SEGGER_RTT.aUp[channel], len, span);
+}
+
+void RTT_Commit(unsigned channel, unsigned len)
+{
+	RTT_CommitBuffer(&_SEGGER_RTT.aUp[channel], len);
+}
+#endif
@@ -0,0 +1,178 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_staging.c
+//!
+//! Lock-free multi-producer, single-consumer staging ring for RTT output.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#include <string.h>
+#ifndef HOST_BUILD
+#include <BDK.h>
+#endif
+#include "rtt_staging.h"
+
+/* Header word: payload length and state bits, 0 while not committed */
+#define STAGING_READY       0x80000000u
+#define STAGING_PAD         0x40000000u
+#define STAGING_LEN_MASK    0x3fffffffu
+
+/* Replace *p by desired if it still holds expected */
+static bool RTT_StagingCas(volatile uint32_t *p, uint32_t expected, uint32_t desired)
+{
+#ifdef HOST_BUILD
+	return __atomic_compare_exchange_n(p, &expected, desired, false,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#else
+	if (__LDREXW(p) != expected)
+	{
+		__CLREX();
+		return false;
+	}
+	return __STREXW(desired, p) == 0;
+#endif
+}
+
+static inline void RTT_StagingBarrier(void)
+{
+#ifdef HOST_BUILD
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#else
+	__DMB();
+#endif
+}
+
+static void RTT_StagingDrop(RTT_Staging *ring, unsigned len)
+{
+	uint32_t n;
+
+	do {
+		n = ring->dropped;
+	} while (!RTT_StagingCas(&ring->dropped, n, n + len));
+}
+
+void RTT_StagingInit(RTT_Staging *ring, uint32_t *buf, uint32_t size)
+{
+	memset(buf, 0, size);
+	ring->buf = buf;
+	ring->size = size;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->seen = 0;
+	ring->sent = 0;
+	ring->written = 0;
+	ring->dropped = 0;
+}
+
+void *RTT_StagingReserve(RTT_Staging *ring, unsigned len)
+{
+	uint32_t need = RTT_STAGING_RECORD_SIZE(len);
+	uint32_t head;
+	uint32_t pos;
+	uint32_t pad;
+
+	if (len > RTT_STAGING_MAX_RECORD || need > ring->size)
+	{
+		RTT_StagingDrop(ring, len);
+		return NULL;
+	}
+
+	do {
+		head = ring->head;
+		pos = head & (ring->size - 1);
+		pad = (ring->size - pos < need) ? ring->size - pos : 0;
+
+		if (head + pad + need - ring->tail > ring->size)
+		{
+			RTT_StagingDrop(ring, len);
+			return NULL;
+		}
+	} while (!RTT_StagingCas(&ring->head, head, head + pad + need));
+
+	/* The area is ours now; the drain stops at its zero header */
+	if (pad)
+	{
+		ring->buf[pos / 4] = STAGING_READY | STAGING_PAD | pad;
+		pos = 0;
+	}
+	ring->buf[pos / 4] = len;
+	return &ring->buf[pos / 4 + 1];
+}
+
+void RTT_StagingCommit(RTT_Staging *ring, void *record)
+{
+	volatile uint32_t *header = (uint32_t *)record - 1;
+
+	(void)ring;
+
+	/* Payload must be in memory before the drain can see the record */
+	RTT_StagingBarrier();
+	*header |= STAGING_READY;
+}
+
+bool RTT_StagingWrite(RTT_Staging *ring, const void *data, unsigned len)
+{
+	void *record = RTT_StagingReserve(ring, len);
+
+	if (record == NULL)
+	{
+		return false;
+	}
+
+	memcpy(record, data, len);
+	RTT_StagingCommit(ring, record);
+	return true;
+}
+
+unsigned RTT_StagingDrain(RTT_Staging *ring, RTT_WriteFunc write, unsigned channel)
+{
+	uint32_t tail = ring->tail;
+	unsigned total = 0;
+
+	ring->seen = ring->head;
+	while (tail != ring->head)
+	{
+		uint32_t *header = &ring->buf[(tail & (ring->size - 1)) / 4];
+		uint32_t word = *(volatile uint32_t *)header;
+		uint32_t len = word & STAGING_LEN_MASK;
+		uint32_t used;
+
+		if (!(word & STAGING_READY))
+		{
+			break;
+		}
+		RTT_StagingBarrier();
+
+		if (word & STAGING_PAD)
+		{
+			used = len;
+		}
+		else
+		{
+			/* A short write keeps the record, the rest goes out next time */
+			unsigned n = write(channel, (const uint8_t *)(header + 1) + ring->sent,
+					len - ring->sent);
+
+			total += n;
+			if (ring->sent + n < len)
+			{
+				ring->sent += n;
+				break;
+			}
+			ring->sent = 0;
+			used = RTT_STAGING_RECORD_SIZE(len);
+		}
+
+		/* A later record may put its header anywhere in this area */
+		memset(header, 0, used);
+		RTT_StagingBarrier();
+		tail += used;
+		ring->tail = tail;
+	}
+
+	ring->written += total;
+	return total;
+}
+
+bool RTT_StagingPending(const RTT_Staging *ring)
+{
+	return ring->head != ring->seen;
+}
@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_stream.c
+//!
+//! Format-free streaming output for bulk data.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "rtt_stream.h"
+
+static void RTT_StreamOut(RTT_Stream *s, const void *data, unsigned len)
+{
+	unsigned n = s->write(s->channel, data, len);
+
+	s->written += n;
+	s->dropped += len - n;
+}
+
+void RTT_StreamInit(RTT_Stream *s, RTT_WriteFunc write, unsigned channel,
+		char *buf, unsigned size)
+{
+	s->write = write;
+	s->channel = channel;
+	s->buf = buf;
+	s->size = size;
+	s->used = 0;
+	s->written = 0;
+	s->dropped = 0;
+}
+
+void RTT_StreamWrite(RTT_Stream *s, const void *data, unsigned len)
+{
+	if (s->used + len > s->size)
+	{
+		RTT_StreamFlush(s);
+	}
+
+	if (len >= s->size)
+	{
+		RTT_StreamOut(s, data, len);
+		return;
+	}
+
+	memcpy(s->buf + s->used, data, len);
+	s->used += len;
+}
+
+void RTT_StreamFlush(RTT_Stream *s)
+{
+	if (s->used > 0)
+	{
+		RTT_StreamOut(s, s->buf, s->used);
+		s->used = 0;
+	}
+}
@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+//! \file timing.c
+//!
+//! High resolution time source for benchmarks.
+//-----------------------------------------------------------------------------
+#if defined(HOST_BUILD) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include "timing.h"
+
+#if defined(HOST_BUILD)
+
+#include <time.h>
+
+void TIMING_Initialize(void)
+{
+}
+
+uint32_t TIMING_Now(void)
+{
+	return (uint32_t)TIMING_Now64();
+}
+
+uint64_t TIMING_Now64(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t TIMING_TickHz(void)
+{
+	return 1000000000u;
+}
+
+#else
+
+#include <BDK.h>
+
+/* High word and last low word seen by TIMING_Now64 */
+static uint32_t timing_high;
+static uint32_t timing_last;
+
+#if defined(USING_SW_TIMER)
+
+#include <SoftwareTimer.h>
+#include <RTE_SoftwareTimer.h>
+
+/* SwTimer_ExpireInMs limits the period to whole milliseconds */
+#define TIMING_SW_TIMER_PERIOD_MS \
+	((RTE_SW_TIMER_RESOLUTION < 1000) ? 1 : (RTE_SW_TIMER_RESOLUTION / 1000))
+
+static SwTimer timing_timer;
+static volatile uint32_t timing_ticks;
+
+static void TIMING_SwTimerTick(void *arg)
+{
+	(void)arg;
+	timing_ticks++;
+	SwTimer_ExpireInMs(&timing_timer, TIMING_SW_TIMER_PERIOD_MS);
+}
+
+void TIMING_Initialize(void)
+{
+	SwTimer_Initialize(&timing_timer);
+	SwTimer_AttachInt(&timing_timer, &TIMING_SwTimerTick, NULL);
+	SwTimer_ExpireInMs(&timing_timer, TIMING_SW_TIMER_PERIOD_MS);
+}
+
+uint32_t TIMING_Now(void)
+{
+	return timing_ticks;
+}
+
+uint32_t TIMING_TickHz(void)
+{
+	return 1000 / TIMING_SW_TIMER_PERIOD_MS;
+}
+
+#else
+
+void TIMING_Initialize(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t TIMING_Now(void)
+{
+	return DWT->CYCCNT;
+}
+
+uint32_t TIMING_TickHz(void)
+{
+	return SystemCoreClock;
+}
+
+#endif /* USING_SW_TIMER */
+
+uint64_t TIMING_Now64(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	uint32_t now;
+	uint64_t result;
+
+	__disable_irq();
+	now = TIMING_Now();
+	if (now < timing_last)
+	{
+		timing_high++;
+	}
+	timing_last = now;
+	result = ((uint64_t)timing_high << 32) | now;
+	__set_PRIMASK(primask);
+
+	return result;
+}
+
+#endif /* HOST_BUILD */
+
+uint64_t TIMING_TicksToNs(uint64_t ticks)
+{
+	uint32_t hz = TIMING_TickHz();
+
+	/* Split so ticks * 10^9 cannot overflow */
+	return ticks / hz * 1000000000u + ticks % hz * 1000000000u / hz;
+}
+
+uint64_t TIMING_TicksToUs(uint64_t ticks)
+{
+	uint32_t hz = TIMING_TickHz();
+
+	return ticks / hz * 1000000u + ticks % hz * 1000000u / hz;
+}
@@ -0,0 +1,348 @@
+//-----------------------------------------------------------------------------
+//! \file wheel.c
+//!
+//! Hierarchical timing wheel for many concurrent software timers.
+//-----------------------------------------------------------------------------
+#include <stddef.h>
+#ifndef HOST_BUILD
+#include <BDK.h>
+#endif
+#include "wheel.h"
+
+#define WHEEL_SLOT_MASK     (WHEEL_SLOTS - 1)
+#define WHEEL_RANGE_MASK    ((1u << WHEEL_RANGE_BITS) - 1)
+
+/* Ticks below the slots of level L */
+#define WHEEL_LOW_MASK(L)   ((1u << (WHEEL_SLOT_BITS * (L))) - 1)
+
+/* Slot of tick t on level L */
+#define WHEEL_DIGIT(t, L)   (((t) >> (WHEEL_SLOT_BITS * (L))) & WHEEL_SLOT_MASK)
+
+static inline unsigned WHEEL_Clz(uint32_t v)
+{
+#ifdef HOST_BUILD
+	return (unsigned)__builtin_clz(v);
+#else
+	return __CLZ(v);
+#endif
+}
+
+/* Index of the lowest set bit, v != 0 */
+static inline unsigned WHEEL_Ctz(uint32_t v)
+{
+#ifdef HOST_BUILD
+	return (unsigned)__builtin_ctz(v);
+#else
+	return __CLZ(__RBIT(v));
+#endif
+}
+
+/* List of level and slot, level WHEEL_LEVELS is the overflow list */
+static WHEEL_Timer **WHEEL_List(WHEEL_Wheel *w, unsigned level, unsigned slot)
+{
+	return (level < WHEEL_LEVELS) ? &w->slot[level][slot] : &w->overflow;
+}
+
+/* Lists are circular, the head's prev is the newest timer */
+static void WHEEL_Append(WHEEL_Timer **head, WHEEL_Timer *t)
+{
+	WHEEL_Timer *first = *head;
+
+	if (first == NULL)
+	{
+		t->next = t;
+		t->prev = t;
+		*head = t;
+		return;
+	}
+	t->next = first;
+	t->prev = first->prev;
+	first->prev->next = t;
+	first->prev = t;
+}
+
+/* Empty a list and return it NULL terminated, oldest timer first */
+static WHEEL_Timer *WHEEL_TakeList(WHEEL_Timer **head)
+{
+	WHEEL_Timer *list = *head;
+
+	*head = NULL;
+	if (list != NULL)
+	{
+		list->prev->next = NULL;
+	}
+	return list;
+}
+
+/* Link an armed timer into the list for its expiry relative to w->now */
+static void WHEEL_Insert(WHEEL_Wheel *w, WHEEL_Timer *t)
+{
+	uint32_t diff = t->expiry ^ w->now;
+	unsigned level;
+	unsigned slot;
+
+	if (diff > WHEEL_RANGE_MASK)
+	{
+		t->level = WHEEL_LEVELS;
+		WHEEL_Append(&w->overflow, t);
+		return;
+	}
+
+	/* Highest differing bit, equal times go to the current level 0 slot */
+	level = diff ? (31 - WHEEL_Clz(diff)) / WHEEL_SLOT_BITS : 0;
+	slot = WHEEL_DIGIT(t->expiry, level);
+	t->level = (uint8_t)level;
+	t->slot = (uint8_t)slot;
+	WHEEL_Append(&w->slot[level][slot], t);
+	w->occupied[level] |= 1u << slot;
+}
+
+static void WHEEL_Unlink(WHEEL_Wheel *w, WHEEL_Timer *t)
+{
+	WHEEL_Timer **head = WHEEL_List(w, t->level, t->slot);
+
+	if (t->next == t)
+	{
+		*head = NULL;
+		if (t->level < WHEEL_LEVELS)
+		{
+			w->occupied[t->level] &= ~(1u << t->slot);
+		}
+	}
+	else
+	{
+		t->prev->next = t->next;
+		t->next->prev = t->prev;
+		if (*head == t)
+		{
+			*head = t->next;
+		}
+	}
+	t->next = NULL;
+	t->prev = NULL;
+}
+
+/* Take the whole list of a slot */
+static WHEEL_Timer *WHEEL_TakeSlot(WHEEL_Wheel *w, unsigned level, unsigned slot)
+{
+	w->occupied[level] &= ~(1u << slot);
+	return WHEEL_TakeList(&w->slot[level][slot]);
+}
+
+/* In list order, so timers with the same expiry keep their arming order */
+static void WHEEL_Reinsert(WHEEL_Wheel *w, WHEEL_Timer *list)
+{
+	while (list != NULL)
+	{
+		WHEEL_Timer *t = list;
+
+		list = t->next;
+		WHEEL_Insert(w, t);
+		w->cascaded++;
+	}
+}
+
+/* Everything due at w->now: move timers down, then expire level 0 */
+static unsigned WHEEL_Process(WHEEL_Wheel *w)
+{
+	uint32_t now = w->now;
+	WHEEL_Timer *list;
+	unsigned n = 0;
+
+	if (w->overflow != NULL && (now & WHEEL_RANGE_MASK) == 0)
+	{
+		WHEEL_Reinsert(w, WHEEL_TakeList(&w->overflow));
+	}
+
+	for (unsigned level = WHEEL_LEVELS - 1; level > 0; level--)
+	{
+		unsigned slot = WHEEL_DIGIT(now, level);
+
+		if ((now & WHEEL_LOW_MASK(level)) == 0 && (w->occupied[level] & (1u << slot)))
+		{
+			WHEEL_Reinsert(w, WHEEL_TakeSlot(w, level, slot));
+		}
+	}
+
+	list = WHEEL_TakeSlot(w, 0, WHEEL_DIGIT(now, 0));
+	while (list != NULL)
+	{
+		WHEEL_Timer *t = list;
+
+		/* Detach first, the callback may arm the timer again */
+		list = t->next;
+		t->next = NULL;
+		t->prev = NULL;
+		t->armed = false;
+		w->armed--;
+		w->expired++;
+		t->callback(t->arg);
+		n++;
+	}
+
+	return n;
+}
+
+void WHEEL_Init(WHEEL_Wheel *w, uint32_t now)
+{
+	for (unsigned level = 0; level < WHEEL_LEVELS; level++)
+	{
+		w->occupied[level] = 0;
+		for (unsigned slot = 0; slot < WHEEL_SLOTS; slot++)
+		{
+			w->slot[level][slot] = NULL;
+		}
+	}
+	w->now = now;
+	w->overflow = NULL;
+	w->armed = 0;
+	w->expired = 0;
+	w->cascaded = 0;
+}
+
+void WHEEL_TimerInit(WHEEL_Timer *t, WHEEL_Callback callback, void *arg)
+{
+	t->next = NULL;
+	t->prev = NULL;
+	t->expiry = 0;
+	t->level = 0;
+	t->slot = 0;
+	t->armed = false;
+	t->callback = callback;
+	t->arg = arg;
+}
+
+void WHEEL_Start(WHEEL_Wheel *w, WHEEL_Timer *t, uint32_t expiry)
+{
+	if (t->armed)
+	{
+		WHEEL_Unlink(w, t);
+		w->armed--;
+	}
+
+	/* The current level 0 slot is being processed or already done */
+	if ((int32_t)(expiry - w->now) <= 0)
+	{
+		expiry = w->now + 1;
+	}
+
+	t->expiry = expiry;
+	t->armed = true;
+	w->armed++;
+	WHEEL_Insert(w, t);
+}
+
+void WHEEL_Cancel(WHEEL_Wheel *w, WHEEL_Timer *t)
+{
+	if (t->armed)
+	{
+		WHEEL_Unlink(w, t);
+		t->armed = false;
+		w->armed--;
+	}
+}
+
+/* Level and start tick of the first list that needs processing, level
+ * WHEEL_LEVELS for the overflow list */
+static bool WHEEL_NextList(const WHEEL_Wheel *w, unsigned *level, uint32_t *start)
+{
+	uint32_t now = w->now;
+
+	/* Lower levels always come first, they end before the next upper slot */
+	for (unsigned l = 0; l < WHEEL_LEVELS; l++)
+	{
+		unsigned digit = WHEEL_DIGIT(now, l);
+		uint32_t pending = w->occupied[l];
+
+		/* Level 0 includes the current slot; above, it was moved down already */
+		if (l > 0)
+		{
+			pending = (digit + 1 < WHEEL_SLOTS) ? pending & (~0u << (digit + 1)) : 0;
+		}
+		else
+		{
+			pending &= ~0u << digit;
+		}
+
+		if (pending != 0)
+		{
+			*level = l;
+			*start = (now & ~WHEEL_LOW_MASK(l + 1)) |
+					((uint32_t)WHEEL_Ctz(pending) << (WHEEL_SLOT_BITS * l));
+			return true;
+		}
+	}
+
+	if (w->overflow != NULL)
+	{
+		*level = WHEEL_LEVELS;
+		*start = (now | WHEEL_RANGE_MASK) + 1;
+		return true;
+	}
+
+	return false;
+}
+
+bool WHEEL_NextEvent(const WHEEL_Wheel *w, uint32_t *ticks)
+{
+	unsigned level;
+	uint32_t start;
+
+	if (!WHEEL_NextList(w, &level, &start))
+	{
+		return false;
+	}
+	*ticks = start - w->now;
+	return true;
+}
+
+bool WHEEL_NextExpiry(const WHEEL_Wheel *w, uint32_t *ticks)
+{
+	const WHEEL_Timer *head;
+	const WHEEL_Timer *t;
+	unsigned level;
+	uint32_t start;
+	uint32_t min;
+
+	if (!WHEEL_NextList(w, &level, &start))
+	{
+		return false;
+	}
+
+	/* A level 0 slot is a single tick */
+	if (level == 0)
+	{
+		*ticks = start - w->now;
+		return true;
+	}
+
+	/* Every later list expires after all timers of this one */
+	head = (level < WHEEL_LEVELS) ? w->slot[level][WHEEL_DIGIT(start, level)] : w->overflow;
+	t = head;
+	min = t->expiry - w->now;
+	while ((t = t->next) != head)
+	{
+		if (t->expiry - w->now < min)
+		{
+			min = t->expiry - w->now;
+		}
+	}
+	*ticks = min;
+	return true;
+}
+
+unsigned WHEEL_Advance(WHEEL_Wheel *w, uint32_t now)
+{
+	uint32_t ticks;
+	unsigned n = 0;
+
+	/* Jump from one occupied slot to the next instead of tick by tick */
+	while (WHEEL_NextEvent(w, &ticks) && ticks <= now - w->now)
+	{
+		w->now += ticks;
+		n += WHEEL_Process(w);
+	}
+	w->now = now;
+
+	return n;
+}
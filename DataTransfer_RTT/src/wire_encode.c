@@ -0,0 +1,203 @@
+//-----------------------------------------------------------------------------
+//! \file wire_encode.c
+//!
+//! Interchangeable payload encodings for the RTT frame stream.
+//-----------------------------------------------------------------------------
+#include <string.h>
+#include "wire_encode.h"
+#include "hex_encode.h"
+
+/* Non-zero if any byte of v is 0 */
+#define WIRE_HAS_ZERO(v)    (((v) - 0x01010101u) & ~(v) & 0x80808080u)
+
+static const char wire_base64[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Big endian word from 4 bytes at any alignment */
+static inline uint32_t WIRE_LoadBe(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return __builtin_bswap32(v);
+}
+
+/* Four base64 characters of the 24-bit group g, stored as one word */
+static inline char *WIRE_PutBase64(char *dst, uint32_t g)
+{
+	uint8_t c[4] = {
+		(uint8_t)wire_base64[(g >> 18) & 63], (uint8_t)wire_base64[(g >> 12) & 63],
+		(uint8_t)wire_base64[(g >> 6) & 63], (uint8_t)wire_base64[g & 63]
+	};
+
+	memcpy(dst, c, sizeof(c));
+	return dst + 4;
+}
+
+char *WIRE_EncodeBase64(char *dst, const uint8_t *src, size_t len)
+{
+	/* 12 input bytes as 3 words give 4 groups */
+	while (len >= 12)
+	{
+		uint32_t w0 = WIRE_LoadBe(src);
+		uint32_t w1 = WIRE_LoadBe(src + 4);
+		uint32_t w2 = WIRE_LoadBe(src + 8);
+
+		dst = WIRE_PutBase64(dst, w0 >> 8);
+		dst = WIRE_PutBase64(dst, (w0 << 16) | (w1 >> 16));
+		dst = WIRE_PutBase64(dst, (w1 << 8) | (w2 >> 24));
+		dst = WIRE_PutBase64(dst, w2);
+		src += 12;
+		len -= 12;
+	}
+
+	while (len >= 3)
+	{
+		dst = WIRE_PutBase64(dst, (uint32_t)src[0] << 16 | (uint32_t)src[1] << 8 | src[2]);
+		src += 3;
+		len -= 3;
+	}
+
+	if (len > 0)
+	{
+		uint32_t g = (uint32_t)src[0] << 16 | ((len > 1) ? (uint32_t)src[1] << 8 : 0);
+
+		WIRE_PutBase64(dst, g);
+		dst[3] = '=';
+		if (len == 1)
+		{
+			dst[2] = '=';
+		}
+		dst += 4;
+	}
+
+	return dst;
+}
+
+/* Five Ascii85 digits of v, most significant first; n < 5 keeps the first n */
+static inline char *WIRE_PutBase85(char *dst, uint32_t v, unsigned n)
+{
+	char c[5];
+
+	for (int i = 4; i >= 0; i--)
+	{
+		c[i] = (char)('!' + v % 85);
+		v /= 85;
+	}
+
+	memcpy(dst, c, n);
+	return dst + n;
+}
+
+char *WIRE_EncodeBase85(char *dst, const uint8_t *src, size_t len)
+{
+	while (len >= 4)
+	{
+		dst = WIRE_PutBase85(dst, WIRE_LoadBe(src), 5);
+		src += 4;
+		len -= 4;
+	}
+
+	if (len > 0)
+	{
+		/* Zero padded group, only len + 1 digits are sent */
+		uint8_t last[4] = { 0 };
+
+		memcpy(last, src, len);
+		dst = WIRE_PutBase85(dst, WIRE_LoadBe(last), (unsigned)len + 1);
+	}
+
+	return dst;
+}
+
+char *WIRE_EncodeCobs(char *dst, const uint8_t *src, size_t len)
+{
+	uint8_t *out = (uint8_t *)dst;
+	uint8_t *code_at = out++;
+	unsigned code = 1;
+	size_t i = 0;
+
+	while (i < len)
+	{
+		/* Copy a whole word if it has no zero and fits in the block */
+		if (len - i >= 4 && code <= 0xff - 4)
+		{
+			uint32_t w;
+
+			memcpy(&w, &src[i], sizeof(w));
+			if (!WIRE_HAS_ZERO(w))
+			{
+				memcpy(out, &w, sizeof(w));
+				out += 4;
+				i += 4;
+				code += 4;
+				if (code == 0xff)
+				{
+					*code_at = (uint8_t)code;
+					code_at = out++;
+					code = 1;
+				}
+				continue;
+			}
+		}
+
+		if (src[i] == 0)
+		{
+			*code_at = (uint8_t)code;
+			code_at = out++;
+			code = 1;
+		}
+		else
+		{
+			*out++ = src[i];
+			if (++code == 0xff)
+			{
+				*code_at = (uint8_t)code;
+				code_at = out++;
+				code = 1;
+			}
+		}
+		i++;
+	}
+
+	*code_at = (uint8_t)code;
+	return (char *)out;
+}
+
+static char *WIRE_EncodeHex(char *dst, const uint8_t *src, size_t len)
+{
+	return HEX_EncodeSwar(dst, src, len, HEX_UPPER);
+}
+
+static unsigned WIRE_HexSize(unsigned len)
+{
+	return HEX_ENCODED_SIZE(len);
+}
+
+static unsigned WIRE_Base64Size(unsigned len)
+{
+	return WIRE_BASE64_SIZE(len);
+}
+
+static unsigned WIRE_Base85Size(unsigned len)
+{
+	return WIRE_BASE85_SIZE(len);
+}
+
+static unsigned WIRE_CobsSize(unsigned len)
+{
+	return WIRE_COBS_SIZE(len);
+}
+
+const WIRE_Encoder WIRE_Hex = { "hex", WIRE_EncodeHex, WIRE_HexSize, '\n' };
+const WIRE_Encoder WIRE_Base64 = { "base64", WIRE_EncodeBase64, WIRE_Base64Size, '\n' };
+const WIRE_Encoder WIRE_Base85 = { "base85", WIRE_EncodeBase85, WIRE_Base85Size, '\n' };
+const WIRE_Encoder WIRE_Cobs = { "cobs", WIRE_EncodeCobs, WIRE_CobsSize, 0 };
+
+unsigned WIRE_EncodeFrame(const WIRE_Encoder *encoder, char *dst, const uint8_t *src, size_t len)
+{
+	char *end = encoder->encode(dst, src, len);
+
+	*end++ = encoder->delimiter;
+	return (unsigned)(end - dst);
+}
@@ -0,0 +1,364 @@
+//-----------------------------------------------------------------------------
+//! \file bench_check.cpp
+//!
+//! Host test of the sweep and report logic of the benchmark harness
+//! (bench.h) with stub backends and a fake clock.
+//!
+//! The fake clock only moves when a stub backend sends a frame, by a fixed
+//! cost per frame plus a cost per byte, so the ticks of every run are known
+//! exactly. The checks are grouped:
+//!
+//!   range    BENCH_RangeNext steps, including the last point, ranges that
+//!            end between two points, do not advance or overflow
+//!   sweep    BENCH_Sweep emits every backend, size and loop point in order,
+//!            prepares each size once per backend, calls begin and end once
+//!            per run and reports ticks and bytes of the fake clock;
+//!            BENCH_SweepJobRun emits the same results with the clock also
+//!            moving between turns, and emits at most one point per call
+//!   compute  BENCH_Compute against exact 128-bit arithmetic for us,
+//!            bytes/s and cycles/byte, including zero ticks and zero bytes
+//!   format   BENCH_FormatHeader and BENCH_FormatRow text, the padding of
+//!            the fractions and the length returned when the line is cut
+//!
+//! One line is printed per group:
+//!
+//!     bench_check,group,cases,failures
+//!
+//! The exit status is 1 if any case failed.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "bench.h"
+#include "latency.h"
+}
+
+namespace {
+
+struct Group {
+	const char *name;
+	unsigned cases = 0;
+	unsigned failures = 0;
+
+	explicit Group(const char *n) : name(n) {}
+
+	void Check(bool ok, const std::string &what)
+	{
+		cases++;
+		if (!ok && failures++ < 10)
+		{
+			std::printf("bench_check,ERROR,%s: %s\n", name, what.c_str());
+		}
+	}
+
+	unsigned Report() const
+	{
+		std::printf("bench_check,%s,%u,%u\n", name, cases, failures);
+		return failures;
+	}
+};
+
+std::string Join(const std::vector<uint32_t> &v)
+{
+	std::string s;
+
+	for (uint32_t x : v)
+	{
+		s += (s.empty() ? "" : " ") + std::to_string(x);
+	}
+	return s;
+}
+
+unsigned CheckRanges()
+{
+	struct RangeCase {
+		BENCH_Range range;
+		std::vector<uint32_t> points;
+	};
+	static const RangeCase cases[] = {
+		{ { 1, 1024, 2, 0 }, { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 } },
+		{ { 1, 1000, 2, 0 }, { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512 } },
+		{ { 250, 2500, 10, 0 }, { 250, 2500 } },
+		{ { 10, 50, 1, 10 }, { 10, 20, 30, 40, 50 } },
+		{ { 10, 55, 1, 10 }, { 10, 20, 30, 40, 50 } },
+		{ { 5, 5, 2, 0 }, { 5 } },
+		{ { 7, 100, 1, 0 }, { 7 } },                    // never advances
+		{ { 3, 100, 0, 7 }, { 3, 7 } },                 // constant after one step
+		{ { 0x40000000u, 0xffffffffu, 2, 0 }, { 0x40000000u, 0x80000000u } },  // overflows to 0
+		{ { 0xfffffff0u, 0xffffffffu, 1, 8 }, { 0xfffffff0u, 0xfffffff8u } },  // wraps past last
+	};
+	Group g("range");
+
+	for (const RangeCase &c : cases)
+	{
+		std::vector<uint32_t> got;
+
+		for (uint32_t v = c.range.first; v != 0 && got.size() < 64; v = BENCH_RangeNext(&c.range, v))
+		{
+			got.push_back(v);
+		}
+		g.Check(got == c.points, "range " + std::to_string(c.range.first) + ".." +
+				std::to_string(c.range.last) + " gave " + Join(got) + ", want " + Join(c.points));
+	}
+	return g.Report();
+}
+
+// Fake clock and stub backends
+uint32_t fake_now;
+
+uint32_t FakeNow()
+{
+	return fake_now;
+}
+
+struct Stub {
+	uint32_t per_frame;
+	uint32_t per_byte;
+	uint32_t end_cost;
+	unsigned begins;
+	unsigned ends;
+	unsigned sends;
+	unsigned bad_frames;
+};
+
+Stub stubs[2] = { { 40, 3, 100, 0, 0, 0, 0 }, { 7, 1, 0, 0, 0, 0, 0 } };
+std::string prepared;
+unsigned prepares;
+
+template <int N>
+void StubBegin()
+{
+	stubs[N].begins++;
+	fake_now += 1000;           // before the clock starts, not measured
+}
+
+template <int N>
+void StubSend(const char *frame, unsigned len)
+{
+	stubs[N].sends++;
+	stubs[N].bad_frames += frame != prepared.data() || len != prepared.size();
+	fake_now += stubs[N].per_frame + stubs[N].per_byte * len;
+}
+
+template <int N>
+void StubEnd()
+{
+	stubs[N].ends++;
+	fake_now += stubs[N].end_cost;
+}
+
+unsigned Prepare(unsigned size, const char **frame)
+{
+	prepares++;
+	prepared.assign(2 * size + 1, 'A');
+	*frame = prepared.data();
+	return (unsigned)prepared.size();
+}
+
+std::vector<BENCH_Result> emitted;
+
+void Emit(const BENCH_Result *result)
+{
+	emitted.push_back(*result);
+}
+
+const BENCH_Backend backends[] = {
+	{ "slow", StubBegin<0>, StubSend<0>, StubEnd<0> },
+	{ "fast", nullptr, StubSend<1>, nullptr },
+};
+
+unsigned CheckSweep()
+{
+	const BENCH_Clock clock = { FakeNow, 1000000u, 48000000u };
+	const BENCH_SweepConfig config = { { 1, 40, 2, 0 }, { 3, 300, 10, 0 } };
+	const std::vector<uint32_t> sizes = { 1, 2, 4, 8, 16, 32 };
+	const std::vector<uint32_t> loops = { 3, 30, 300 };
+	Group g("sweep");
+
+	fake_now = 0xfffff000u;     // runs cross the wrap of the clock
+	BENCH_Sweep(backends, 2, &clock, &config, Prepare, Emit);
+
+	g.Check(emitted.size() == 2 * sizes.size() * loops.size(),
+			std::to_string(emitted.size()) + " results emitted");
+	g.Check(prepares == 2 * sizes.size(), std::to_string(prepares) + " frames prepared");
+	g.Check(stubs[0].begins == sizes.size() * loops.size() && stubs[0].ends == stubs[0].begins,
+			"begin/end not called once per run");
+	g.Check(stubs[0].bad_frames == 0 && stubs[1].bad_frames == 0, "backend got another frame");
+
+	size_t i = 0;
+	for (int b = 0; b < 2; b++)
+	{
+		for (uint32_t size : sizes)
+		{
+			for (uint32_t n : loops)
+			{
+				if (i >= emitted.size())
+				{
+					break;
+				}
+				const BENCH_Result &r = emitted[i++];
+				uint32_t len = 2 * size + 1;
+				uint32_t ticks = n * (stubs[b].per_frame + stubs[b].per_byte * len) + stubs[b].end_cost;
+				std::string at = std::string(backends[b].name) + " size " + std::to_string(size) +
+						" loops " + std::to_string(n);
+
+				g.Check(std::strcmp(r.backend, backends[b].name) == 0 && r.frame_len == len &&
+						r.loops == n, at + ": emitted out of order");
+				g.Check(r.bytes == len * n, at + ": bytes " + std::to_string(r.bytes));
+				g.Check(r.ticks == ticks, at + ": ticks " + std::to_string(r.ticks) +
+						", want " + std::to_string(ticks));
+				g.Check(r.us == ticks, at + ": us " + std::to_string(r.us));
+			}
+		}
+	}
+
+	// The resumable sweep measures the same, although time passes between turns
+	std::vector<BENCH_Result> swept = emitted;
+	static BENCH_SweepJob job;
+	CO_Slice slice;
+	unsigned calls = 0;
+	bool one_per_call = true;
+
+	emitted.clear();
+	prepares = 0;
+	fake_now = 0xffff0000u;
+	CO_SliceInit(&slice, FakeNow, 7, 0);
+	BENCH_SweepJobInit(&job, backends, 2, &clock, &config, Prepare, Emit);
+	for (CO_Status st = CO_YIELDED; st != CO_DONE && calls < 100000; calls++)
+	{
+		size_t before = emitted.size();
+
+		st = BENCH_SweepJobRun(&job, &slice);
+		one_per_call &= emitted.size() <= before + 1;
+		fake_now += 12345;
+	}
+	g.Check(emitted.size() == swept.size() && prepares == 2 * sizes.size(),
+			"sweep job: " + std::to_string(emitted.size()) + " results, " + std::to_string(prepares) +
+			" frames prepared");
+	g.Check(one_per_call, "sweep job emitted several points in one call");
+	for (size_t j = 0; j < emitted.size() && j < swept.size(); j++)
+	{
+		const BENCH_Result &a = emitted[j];
+		const BENCH_Result &b = swept[j];
+
+		g.Check(a.backend == b.backend && a.frame_len == b.frame_len && a.loops == b.loops &&
+				a.ticks == b.ticks && a.us == b.us && a.bytes_per_s == b.bytes_per_s,
+				"sweep job result " + std::to_string(j) + ": ticks " + std::to_string(a.ticks) +
+				", want " + std::to_string(b.ticks));
+	}
+
+	// The histogram variant records every frame and measures the same
+	static LAT_Histogram latency;
+	BENCH_Result r;
+	const char *frame;
+	unsigned len = Prepare(10, &frame);
+	LAT_Reset(&latency);
+	BENCH_Run(&backends[1], &clock, frame, len, 50, &r, &latency);
+	g.Check(latency.count == 50 && r.ticks == 50 * (7 + 21),
+			"latency run: " + std::to_string(latency.count) + " records, " + std::to_string(r.ticks) + " ticks");
+	return g.Report();
+}
+
+unsigned CheckCompute()
+{
+	struct ComputeCase {
+		uint32_t tick_hz;
+		uint32_t core_hz;
+		uint32_t ticks;
+		uint32_t bytes;
+	};
+	static const ComputeCase cases[] = {
+		{ 48000000u, 48000000u, 4800000u, 402500u },    // DWT at the core clock
+		{ 1000000u, 48000000u, 123457u, 402500u },      // 1 us ticks
+		{ 48000000u, 48000000u, 0, 161 },               // shorter than a tick
+		{ 48000000u, 48000000u, 5000, 0 },              // nothing sent
+		{ 48000000u, 48000000u, 0xffffffffu, 0xffffffffu },
+		{ 32768u, 48000000u, 0xffffffffu, 0xffffffffu },    // slow clock, long run
+		{ 48000000u, 8000000u, 7, 1000000u },           // less than a cycle per byte
+		{ 3000000u, 48000000u, 1, 1 },
+	};
+	Group g("compute");
+
+	for (const ComputeCase &c : cases)
+	{
+		const BENCH_Clock clock = { FakeNow, c.tick_hz, c.core_hz };
+		BENCH_Result r = {};
+		unsigned __int128 ticks = c.ticks ? c.ticks : 1;
+		unsigned __int128 cycles = ticks * c.core_hz / c.tick_hz;
+		uint32_t us = (uint32_t)((unsigned __int128)c.ticks * 1000000u / c.tick_hz);
+		uint32_t bps = (uint32_t)((unsigned __int128)c.bytes * c.tick_hz / ticks);
+		uint32_t cpb = c.bytes ? (uint32_t)(cycles * 100u / c.bytes) : 0;
+		std::string at = "ticks " + std::to_string(c.ticks) + " bytes " + std::to_string(c.bytes) +
+				" at " + std::to_string(c.tick_hz) + " Hz";
+
+		r.ticks = c.ticks;
+		r.bytes = c.bytes;
+		BENCH_Compute(&clock, &r);
+		g.Check(r.us == us, at + ": us " + std::to_string(r.us) + ", want " + std::to_string(us));
+		g.Check(r.bytes_per_s == bps, at + ": bytes/s " + std::to_string(r.bytes_per_s) +
+				", want " + std::to_string(bps));
+		g.Check(r.cycles_per_byte_x100 == cpb, at + ": cycles/byte x100 " +
+				std::to_string(r.cycles_per_byte_x100) + ", want " + std::to_string(cpb));
+	}
+	return g.Report();
+}
+
+unsigned CheckFormat()
+{
+	struct FormatCase {
+		BENCH_Result result;
+		const char *text;
+	};
+	static const FormatCase cases[] = {
+		{ { "printf", 161, 2500, 402500, 0, 1234567, 326021, 1234 },
+				"bench,printf,161,2500,402500,1234.567,326021,12.34\n" },
+		{ { "SEGGER_RTT_Write", 3, 1, 3, 0, 5, 600000, 5 },
+				"bench,SEGGER_RTT_Write,3,1,3,0.005,600000,0.05\n" },
+		{ { "x", 0, 0, 0, 0, 0, 0, 0 }, "bench,x,0,0,0,0.000,0,0.00\n" },
+		{ { "max", 0xffffffffu, 0xffffffffu, 0xffffffffu, 0, 0xffffffffu, 0xffffffffu, 0xffffffffu },
+				"bench,max,4294967295,4294967295,4294967295,4294967.295,4294967295,42949672.95\n" },
+	};
+	Group g("format");
+	char buf[BENCH_LINE_SIZE];
+	int n;
+
+	n = BENCH_FormatHeader(buf, sizeof(buf));
+	g.Check(std::string(buf) == "bench,backend,frame,loops,bytes,ms,bytes_per_s,cycles_per_byte\n" &&
+			n == (int)std::strlen(buf), std::string("header ") + buf);
+
+	for (const FormatCase &c : cases)
+	{
+		n = BENCH_FormatRow(buf, sizeof(buf), &c.result);
+		g.Check(std::string(buf) == c.text && n == (int)std::strlen(c.text),
+				std::string("row '") + buf + "', want '" + c.text + "'");
+	}
+
+	// A short buffer keeps a terminated prefix and returns the full length
+	n = BENCH_FormatRow(buf, 10, &cases[0].result);
+	g.Check(n == (int)std::strlen(cases[0].text) && std::string(buf) == std::string(cases[0].text, 9),
+			"cut row '" + std::string(buf) + "'");
+	return g.Report();
+}
+
+} // namespace
+
+int main()
+{
+	unsigned failures = 0;
+
+	failures += CheckRanges();
+	failures += CheckSweep();
+	failures += CheckCompute();
+	failures += CheckFormat();
+
+	if (failures)
+	{
+		std::printf("bench_check,FAILED,%u\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,445 @@
+//-----------------------------------------------------------------------------
+//! \file btn_replay.cpp
+//!
+//! Host test of the button edge ring (btn_ring.h) with recorded edges.
+//!
+//! A recording is a list of button edges with their time in microseconds.
+//! The replay captures each edge at its time with the cycle counter of a
+//! simulated core clock that wraps during the run, and delivers the ring
+//! on every main loop pass. The test fails if an edge is delivered with a
+//! wrong button, direction or stamp, out of order or twice, if an edge is
+//! dropped while the ring has room or kept while it is full, or if the
+//! edges lost do not match the overflow counter. The old scheduled callback is
+//! modelled as well: one event per button and pass, reporting the state
+//! at the pass.
+//!
+//!     btn,recording,edges,delivered,overflow,scheduled_events,max_delay_us
+//!
+//! --threads runs a producer and a consumer thread on the ring instead,
+//! the producer stamping edges with a sequence number:
+//!
+//!     btn,threads,edges,delivered,overflow,batches
+//-----------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "btn_ring.h"
+}
+
+namespace {
+
+struct Options {
+	unsigned pass_us = 20000;       // time between main loop passes
+	unsigned clock_hz = 8000000;    // SystemCoreClock
+	unsigned threads = 0;           // edges of the thread test, 0 replays
+	std::vector<std::string> files;
+};
+
+struct Edge {
+	uint32_t us;
+	uint8_t button;
+	uint8_t edge;
+};
+
+struct Recording {
+	std::string name;
+	std::vector<Edge> edges;
+};
+
+// Built-in recordings ---------------------------------------------------------
+
+void Add(std::vector<Edge> &v, uint32_t us, unsigned button, BTNR_Edge edge)
+{
+	v.push_back({ us, (uint8_t)button, (uint8_t)edge });
+}
+
+// A clean press and release, then a double press with the presses 70 ms apart
+Recording DoublePress()
+{
+	Recording r = { "double_press", {} };
+
+	Add(r.edges, 10000, 0, BTNR_PRESSED);
+	Add(r.edges, 130000, 0, BTNR_RELEASED);
+	Add(r.edges, 500000, 0, BTNR_PRESSED);
+	Add(r.edges, 535000, 0, BTNR_RELEASED);
+	Add(r.edges, 570000, 0, BTNR_PRESSED);
+	Add(r.edges, 604000, 0, BTNR_RELEASED);
+	return r;
+}
+
+// Contact bounce: bursts of edges tens of microseconds apart on each change,
+// the longest one more than the ring holds
+Recording Bounce()
+{
+	Recording r = { "bounce", {} };
+	uint32_t t = 5000;
+
+	for (unsigned press = 0; press < 3; press++)
+	{
+		for (unsigned i = 0; i < 16 + 12 * press; i++)
+		{
+			Add(r.edges, t, 1, (i & 1) ? BTNR_RELEASED : BTNR_PRESSED);
+			t += 30 + 7 * i;
+		}
+		Add(r.edges, t, 1, BTNR_PRESSED);
+		t += 150000;
+		for (unsigned i = 0; i < 15; i++)
+		{
+			Add(r.edges, t, 1, (i & 1) ? BTNR_PRESSED : BTNR_RELEASED);
+			t += 40 + 5 * i;
+		}
+		t += 200000;
+	}
+	return r;
+}
+
+// Both buttons held in overlapping presses, edges close together
+Recording BothButtons()
+{
+	Recording r = { "both_buttons", {} };
+
+	Add(r.edges, 1000, 0, BTNR_PRESSED);
+	Add(r.edges, 4000, 1, BTNR_PRESSED);
+	Add(r.edges, 9000, 0, BTNR_RELEASED);
+	Add(r.edges, 9500, 0, BTNR_PRESSED);
+	Add(r.edges, 52000, 1, BTNR_RELEASED);
+	Add(r.edges, 52100, 0, BTNR_RELEASED);
+	Add(r.edges, 300000, 1, BTNR_PRESSED);
+	Add(r.edges, 300200, 1, BTNR_RELEASED);
+	return r;
+}
+
+// "us,button,edge" per line, edge 1 for pressed; '#' starts a comment
+bool LoadRecording(const std::string &path, Recording *r)
+{
+	std::ifstream in(path);
+	std::string line;
+
+	if (!in)
+	{
+		std::fprintf(stderr, "btn_replay: cannot open %s\n", path.c_str());
+		return false;
+	}
+
+	r->name = path;
+	while (std::getline(in, line))
+	{
+		unsigned long us;
+		unsigned button;
+		unsigned edge;
+
+		if (line.empty() || line[0] == '#')
+		{
+			continue;
+		}
+		if (std::sscanf(line.c_str(), "%lu,%u,%u", &us, &button, &edge) != 3 || button > 255 || edge > 1 ||
+				(!r->edges.empty() && us < r->edges.back().us))
+		{
+			std::fprintf(stderr, "btn_replay: %s: bad line '%s'\n", path.c_str(), line.c_str());
+			return false;
+		}
+		Add(r->edges, (uint32_t)us, button, (BTNR_Edge)edge);
+	}
+	return true;
+}
+
+// Replay ----------------------------------------------------------------------
+
+struct Replay {
+	const std::vector<Edge> *edges;
+	std::vector<uint32_t> stamps;   // expected stamp of every edge
+	std::vector<bool> dropped;      // edges the ring had no room for
+	size_t next = 0;                // next edge expected from the ring
+	uint32_t pass_us = 0;
+	uint32_t max_delay_us = 0;
+	unsigned batches = 0;
+	unsigned errors = 0;
+};
+
+void ReplayHandler(const BTNR_Event *events, unsigned count, void *arg)
+{
+	Replay *p = static_cast<Replay *>(arg);
+
+	p->batches++;
+	for (unsigned i = 0; i < count; i++)
+	{
+		while (p->next < p->edges->size() && p->dropped[p->next])
+		{
+			p->next++;
+		}
+		if (p->next >= p->edges->size())
+		{
+			std::printf("btn,ERROR,extra edge delivered\n");
+			p->errors++;
+			return;
+		}
+
+		const Edge &want = (*p->edges)[p->next];
+		if (events[i].button != want.button || events[i].edge != want.edge ||
+				events[i].stamp != p->stamps[p->next])
+		{
+			std::printf("btn,ERROR,edge %zu delivered as %u,%u,%lu\n", p->next,
+					events[i].button, events[i].edge, (unsigned long)events[i].stamp);
+			p->errors++;
+		}
+		if (p->pass_us - want.us > p->max_delay_us)
+		{
+			p->max_delay_us = p->pass_us - want.us;
+		}
+		p->next++;
+	}
+}
+
+unsigned RunReplay(const Options &opt, const Recording &rec)
+{
+	const std::vector<Edge> &edges = rec.edges;
+	uint32_t cycles_per_us = opt.clock_hz / 1000000;
+	uint32_t start = 0u - 3000000u * cycles_per_us;     // wraps after 3 s
+	static BTNR_Ring ring;
+	Replay p;
+	size_t e = 0;
+	size_t queued = 0;
+	unsigned scheduled = 0;
+	uint32_t pass_us = opt.pass_us;
+
+	p.edges = &edges;
+	p.dropped.assign(edges.size(), false);
+	for (const Edge &edge : edges)
+	{
+		p.stamps.push_back(start + edge.us * cycles_per_us);
+	}
+	BTNR_Init(&ring);
+
+	while (e < edges.size() || BTNR_Pending(&ring))
+	{
+		bool changed[256] = {};
+
+		// The interrupts of all edges before this pass
+		for (; e < edges.size() && edges[e].us < pass_us; e++)
+		{
+			bool room = queued < BTNR_SIZE;
+
+			if (BTNR_Capture(&ring, edges[e].button, (BTNR_Edge)edges[e].edge, p.stamps[e]) != room)
+			{
+				std::printf("btn,ERROR,edge %zu %s with %zu queued\n", e, room ? "dropped" : "kept", queued);
+				p.errors++;
+			}
+			p.dropped[e] = !room;
+			queued += room;
+			changed[edges[e].button] = true;
+		}
+
+		p.pass_us = pass_us;
+		unsigned batches = p.batches;
+		unsigned n = BTNR_Deliver(&ring, ReplayHandler, &p);
+		if (n != queued || p.batches - batches > 2 || BTNR_Pending(&ring))
+		{
+			std::printf("btn,ERROR,pass at %lu us delivered %u of %zu\n", (unsigned long)pass_us, n, queued);
+			p.errors++;
+		}
+		queued = 0;
+
+		// BTN_AttachScheduled: one callback per button that changed
+		for (unsigned b = 0; b < 256; b++)
+		{
+			scheduled += changed[b];
+		}
+		pass_us += opt.pass_us;
+	}
+
+	unsigned lost = 0;
+	for (bool d : p.dropped)
+	{
+		lost += d;
+	}
+	if (ring.overflow != lost || ring.delivered != edges.size() - lost)
+	{
+		std::printf("btn,ERROR,overflow %lu delivered %lu, expected %u and %zu\n",
+				(unsigned long)ring.overflow, (unsigned long)ring.delivered, lost, edges.size() - lost);
+		p.errors++;
+	}
+
+	std::printf("btn,%s,%zu,%lu,%lu,%u,%lu\n", rec.name.c_str(), edges.size(),
+			(unsigned long)ring.delivered, (unsigned long)ring.overflow, scheduled,
+			(unsigned long)p.max_delay_us);
+	return p.errors;
+}
+
+// Threads ---------------------------------------------------------------------
+
+struct ThreadCheck {
+	uint32_t expect = 0;        // next sequence number
+	uint64_t gaps = 0;          // sequence numbers skipped
+	unsigned batches = 0;
+	unsigned errors = 0;
+};
+
+void ThreadHandler(const BTNR_Event *events, unsigned count, void *arg)
+{
+	ThreadCheck *c = static_cast<ThreadCheck *>(arg);
+
+	c->batches++;
+	for (unsigned i = 0; i < count; i++)
+	{
+		uint32_t seq = events[i].stamp;
+
+		// Button and edge are derived from the sequence number
+		if ((int32_t)(seq - c->expect) < 0 || events[i].button != (seq & 1) ||
+				events[i].edge != ((seq >> 1) & 1))
+		{
+			c->errors++;
+		}
+		c->gaps += seq - c->expect;
+		c->expect = seq + 1;
+	}
+}
+
+unsigned RunThreads(unsigned edges)
+{
+	static BTNR_Ring ring;
+	std::atomic<bool> done(false);
+	ThreadCheck check;
+
+	BTNR_Init(&ring);
+
+	std::thread producer([&]() {
+		for (uint32_t seq = 0; seq < edges; seq++)
+		{
+			BTNR_Capture(&ring, seq & 1, (BTNR_Edge)((seq >> 1) & 1), seq);
+			// Bursts longer than the ring when the threads alternate
+			if ((seq % 61) == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+		done = true;
+	});
+
+	std::thread consumer([&]() {
+		for (;;)
+		{
+			bool finished = done;
+
+			if (BTNR_Deliver(&ring, ThreadHandler, &check) == 0)
+			{
+				if (finished)
+				{
+					break;
+				}
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	producer.join();
+	consumer.join();
+
+	// Edges lost at the end show up as a gap to the total
+	check.gaps += edges - check.expect;
+	if (check.gaps != ring.overflow || ring.delivered + ring.overflow != edges)
+	{
+		check.errors++;
+	}
+
+	std::printf("btn,threads,%u,%lu,%lu,%u\n", edges, (unsigned long)ring.delivered,
+			(unsigned long)ring.overflow, check.batches);
+	if (check.errors)
+	{
+		std::printf("btn,ERROR,%u bad sequences, %llu gaps for overflow %lu\n", check.errors,
+				(unsigned long long)check.gaps, (unsigned long)ring.overflow);
+	}
+	return check.errors;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: btn_replay [options] [recording.csv...]\n"
+			"  --pass-us N         time between main loop passes (20000)\n"
+			"  --clock-hz N        core clock of the cycle stamps (8000000)\n"
+			"  --threads N         run N edges through a producer and a consumer thread\n"
+			"Without files the built-in recordings are replayed. A recording has\n"
+			"one 'us,button,edge' line per edge, edge 1 for pressed.\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--pass-us") opt.pass_us = (unsigned)value();
+		else if (arg == "--clock-hz") opt.clock_hz = (unsigned)value();
+		else if (arg == "--threads") opt.threads = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else if (arg[0] == '-')
+		{
+			Usage();
+			return 2;
+		}
+		else opt.files.push_back(arg);
+	}
+
+	if (opt.pass_us == 0 || opt.clock_hz < 1000000)
+	{
+		Usage();
+		return 2;
+	}
+
+	if (opt.threads)
+	{
+		return RunThreads(opt.threads) ? 1 : 0;
+	}
+
+	std::vector<Recording> recordings;
+	if (opt.files.empty())
+	{
+		recordings = { DoublePress(), Bounce(), BothButtons() };
+	}
+	for (const std::string &path : opt.files)
+	{
+		Recording r;
+
+		if (!LoadRecording(path, &r))
+		{
+			return 2;
+		}
+		recordings.push_back(r);
+	}
+
+	unsigned errors = 0;
+	for (const Recording &r : recordings)
+	{
+		errors += RunReplay(opt, r);
+	}
+
+	if (errors)
+	{
+		std::printf("btn,FAILED,%u\n", errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,158 @@
+//-----------------------------------------------------------------------------
+//! \file coroutine_sim.cpp
+//!
+//! Host simulation of the DataTransfer_RTT main loop while a benchmark runs.
+//!
+//! The loop of main() is modelled as: serve every event that has arrived
+//! (BDK_Schedule), then give the test job one turn. The job is a BENCH_Job
+//! (bench.h) whose backend busy-waits for a fixed time per frame, and events
+//! arrive periodically like the 1 ms timer tick or a watchdog deadline.
+//!
+//! The same job is run without yielding, which is what ExecuteTest did
+//! before it became a coroutine, and with the given frame and time slices.
+//! For each mode the event latency from arrival to service is printed as a
+//! "lat,name,..." line (latency.h, nanoseconds) together with the measured
+//! job time, the wall time and the number of turns:
+//!
+//!     sim,mode,frames,job_us,wall_us,turns
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+extern "C" {
+#include "bench.h"
+#include "coroutine.h"
+#include "latency.h"
+#include "timing.h"
+}
+
+namespace {
+
+struct Options {
+	unsigned frames = 2500;     // frames of the job (SEND_LOOP)
+	unsigned work_us = 10;      // busy time of one frame
+	unsigned period_us = 1000;  // event interval
+	unsigned slice_frames = 100;
+	unsigned slice_us = 2000;
+};
+
+uint32_t work_ticks;
+
+void Work(const char *frame, unsigned len)
+{
+	uint32_t start = TIMING_Now();
+
+	(void)frame;
+	(void)len;
+	while (TIMING_Now() - start < work_ticks)
+	{
+	}
+}
+
+const BENCH_Backend busy = { "busy", nullptr, Work, nullptr };
+
+void Run(const Options &opt, const char *mode, uint32_t units, uint32_t us)
+{
+	static LAT_Histogram latency;
+	BENCH_Clock clock = { TIMING_Now, TIMING_TickHz(), TIMING_TickHz() };
+	uint32_t period = (uint32_t)((uint64_t)opt.period_us * clock.tick_hz / 1000000u);
+	BENCH_Result result;
+	BENCH_Job job;
+	CO_Slice slice;
+	unsigned turns = 0;
+	char line[LAT_LINE_SIZE];
+	bool running = true;
+
+	LAT_Reset(&latency);
+	CO_SliceInit(&slice, TIMING_Now, units, (uint32_t)((uint64_t)us * clock.tick_hz / 1000000u));
+	BENCH_JobInit(&job, &busy, &clock, "", 0, opt.frames, &result, nullptr);
+
+	uint32_t start = TIMING_Now();
+	uint32_t next_event = start + period;
+	auto schedule = [&]() {
+		// BDK_Schedule: every event due by now is served now
+		uint32_t now = TIMING_Now();
+		while ((int32_t)(now - next_event) >= 0)
+		{
+			LAT_Record(&latency, now - next_event);
+			next_event += period;
+		}
+	};
+
+	while (running)
+	{
+		schedule();
+		turns++;
+		running = BENCH_JobRun(&job, &slice) != CO_DONE;
+	}
+	schedule();
+	uint32_t wall = TIMING_Now() - start;
+
+	LAT_FormatSummary(line, sizeof(line), mode, &latency, clock.tick_hz);
+	std::fputs(line, stdout);
+	std::printf("sim,%s,%u,%lu,%lu,%u\n", mode, opt.frames, (unsigned long)result.us,
+			(unsigned long)TIMING_TicksToUs(wall), turns);
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: coroutine_sim [options]\n"
+			"  --frames N          frames of the job (2500)\n"
+			"  --work-us N         busy time of one frame (10)\n"
+			"  --period-us N       interval of the events (1000)\n"
+			"  --slice-frames N    frames per turn of the frame slice run (100)\n"
+			"  --slice-us N        microseconds per turn of the time slice run (2000)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--frames") opt.frames = (unsigned)value();
+		else if (arg == "--work-us") opt.work_us = (unsigned)value();
+		else if (arg == "--period-us") opt.period_us = (unsigned)value();
+		else if (arg == "--slice-frames") opt.slice_frames = (unsigned)value();
+		else if (arg == "--slice-us") opt.slice_us = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.period_us == 0)
+	{
+		std::fprintf(stderr, "coroutine_sim: --period-us must not be 0\n");
+		return 2;
+	}
+
+	TIMING_Initialize();
+	work_ticks = (uint32_t)((uint64_t)opt.work_us * TIMING_TickHz() / 1000000u);
+
+	Run(opt, "no-yield", 0, 0);
+	Run(opt, ("frames-" + std::to_string(opt.slice_frames)).c_str(), opt.slice_frames, 0);
+	Run(opt, ("us-" + std::to_string(opt.slice_us)).c_str(), 0, opt.slice_us);
+	return 0;
+}
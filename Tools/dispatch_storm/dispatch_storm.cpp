@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------------
+//! \file dispatch_storm.cpp
+//!
+//! Host benchmark of the event dispatcher (dispatch.h) under event storms.
+//!
+//! Each storm posts a burst of bulk events at low priority, each of which
+//! busy-waits for a fixed time like a producer step. While the burst is
+//! being worked off, one of the bulk events posts an urgent event, standing
+//! in for a button interrupt that arrives at a random point of the batch.
+//!
+//! The storms are run twice with the same random sequence: once with the
+//! urgent event at priority 0 and once at the bulk priority, which models a
+//! single FIFO task list like BDK_Schedule. The time from post to dispatch
+//! of both kinds of events is printed as "lat,name,..." lines (latency.h,
+//! nanoseconds); in the FIFO run the bulk line also counts the urgent
+//! events, which share its priority.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+extern "C" {
+#include "dispatch.h"
+#include "latency.h"
+#include "timing.h"
+}
+
+namespace {
+
+const unsigned PRIO_URGENT = 0;
+const unsigned PRIO_BULK = 16;
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned storms = 1000;
+	unsigned burst = 64;        // bulk events per storm
+	unsigned work_us = 20;      // busy time of one bulk event
+};
+
+struct Storm {
+	DISP_Dispatcher disp;
+	unsigned urgent_prio;
+	unsigned trigger;           // bulk event of the storm that posts the urgent one
+	unsigned done;              // bulk events run in this storm
+	uint32_t work_ticks;
+	uint32_t urgent_posted;
+	LAT_Histogram urgent;
+};
+
+void Urgent(void *arg)
+{
+	Storm *s = static_cast<Storm *>(arg);
+
+	LAT_Record(&s->urgent, TIMING_Now() - s->urgent_posted);
+}
+
+void Bulk(void *arg)
+{
+	Storm *s = static_cast<Storm *>(arg);
+	uint32_t start = TIMING_Now();
+
+	if (s->done++ == s->trigger)
+	{
+		s->urgent_posted = TIMING_Now();
+		DISP_Post(&s->disp, s->urgent_prio, Urgent, s);
+	}
+	while (TIMING_Now() - start < s->work_ticks)
+	{
+	}
+}
+
+int Run(const Options &opt, unsigned urgent_prio, const char *mode)
+{
+	static Storm s;
+	static LAT_Histogram bulk;
+	std::mt19937 rng(opt.seed);
+	char line[LAT_LINE_SIZE];
+	std::string name;
+
+	DISP_Init(&s.disp);
+	LAT_Reset(&s.urgent);
+	LAT_Reset(&bulk);
+	DISP_SetWaitHistogram(&s.disp, PRIO_BULK, &bulk);
+	s.urgent_prio = urgent_prio;
+	s.work_ticks = (uint32_t)((uint64_t)opt.work_us * TIMING_TickHz() / 1000000u);
+
+	for (unsigned n = 0; n < opt.storms; n++)
+	{
+		s.trigger = (unsigned)(rng() % opt.burst);
+		s.done = 0;
+		for (unsigned i = 0; i < opt.burst; i++)
+		{
+			DISP_Post(&s.disp, PRIO_BULK, Bulk, &s);
+		}
+		DISP_Run(&s.disp, opt.burst + 1);
+	}
+
+	name = std::string("urgent-") + mode;
+	LAT_FormatSummary(line, sizeof(line), name.c_str(), &s.urgent, TIMING_TickHz());
+	std::fputs(line, stdout);
+	name = std::string("bulk-") + mode;
+	LAT_FormatSummary(line, sizeof(line), name.c_str(), &bulk, TIMING_TickHz());
+	std::fputs(line, stdout);
+	std::printf("disp,%s,dispatched=%lu,dropped=%lu\n", mode,
+			(unsigned long)s.disp.dispatched, (unsigned long)s.disp.dropped);
+
+	return s.disp.dropped ? 1 : 0;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: dispatch_storm [options]\n"
+			"  --seed N            random sequence of trigger points (1)\n"
+			"  --storms N          number of storms (1000)\n"
+			"  --burst N           bulk events per storm, < DISP_POOL_SIZE (64)\n"
+			"  --work-us N         busy time of one bulk event (20)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--storms") opt.storms = (unsigned)value();
+		else if (arg == "--burst") opt.burst = (unsigned)value();
+		else if (arg == "--work-us") opt.work_us = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.burst == 0 || opt.burst >= DISP_POOL_SIZE)
+	{
+		std::fprintf(stderr, "dispatch_storm: --burst must be 1..%u\n", DISP_POOL_SIZE - 1);
+		return 2;
+	}
+
+	TIMING_Initialize();
+	int bad = Run(opt, PRIO_URGENT, "prio");
+	bad |= Run(opt, PRIO_BULK, "fifo");
+	return bad;
+}
@@ -0,0 +1,216 @@
+//-----------------------------------------------------------------------------
+//! \file hex_check.cpp
+//!
+//! Host equivalence test of the hex encoders (hex_encode.h).
+//!
+//! HEX_EncodeSwar in both letter cases, HEX_Encode and HEX_EncodeNibble are
+//! compared with snprintf("%02X") / ("%02x"):
+//!
+//! - every byte value alone, and in each of the four byte lanes of a word
+//!   surrounded by every other value, so carries between the lanes of the
+//!   SWAR code would show up
+//! - random buffers of every length up to --max-len at all four source and
+//!   destination alignments, with guard bytes around the output
+//!
+//! A case fails if the characters differ, the returned pointer is not the
+//! end of the output or a guard byte was overwritten. One line is printed
+//! per encoder:
+//!
+//!     hex,encoder,cases,failures
+//!
+//! The exit status is 1 if any case failed.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "hex_encode.h"
+}
+
+namespace {
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned max_len = 300;
+	unsigned rounds = 20;       // random buffers per length and alignment
+};
+
+const uint8_t GUARD = 0xa5;
+
+struct Encoder {
+	const char *name;
+	char *(*encode)(char *dst, const uint8_t *src, size_t len);
+	bool lower;
+	unsigned long cases;
+	unsigned long failures;
+};
+
+char *EncodeSwarUpper(char *dst, const uint8_t *src, size_t len)
+{
+	return HEX_EncodeSwar(dst, src, len, HEX_UPPER);
+}
+
+char *EncodeSwarLower(char *dst, const uint8_t *src, size_t len)
+{
+	return HEX_EncodeSwar(dst, src, len, HEX_LOWER);
+}
+
+std::string Reference(const uint8_t *src, size_t len, bool lower)
+{
+	std::string s;
+	char pair[3];
+
+	for (size_t i = 0; i < len; i++)
+	{
+		std::snprintf(pair, sizeof(pair), lower ? "%02x" : "%02X", src[i]);
+		s += pair;
+	}
+	return s;
+}
+
+// Encode src at dst offset align into a guarded buffer and compare
+void Check(Encoder &e, const uint8_t *src, size_t len, unsigned align)
+{
+	std::vector<char> out(HEX_ENCODED_SIZE(len) + 16, (char)GUARD);
+	char *dst = out.data() + 4 + align;
+	char *end = e.encode(dst, src, len);
+	std::string want = Reference(src, len, e.lower);
+	bool ok = end == dst + HEX_ENCODED_SIZE(len) &&
+			std::memcmp(dst, want.data(), want.size()) == 0;
+
+	for (char *p = out.data(); p < dst; p++)
+	{
+		ok = ok && (uint8_t)*p == GUARD;
+	}
+	for (char *p = dst + want.size(); p < out.data() + out.size(); p++)
+	{
+		ok = ok && (uint8_t)*p == GUARD;
+	}
+
+	e.cases++;
+	if (!ok)
+	{
+		if (e.failures++ < 5)
+		{
+			std::printf("hex,ERROR,%s,len %zu align %u: got '%.*s' want '%s'\n", e.name, len, align,
+					(int)want.size(), dst, want.c_str());
+		}
+	}
+}
+
+void CheckBytes(Encoder &e)
+{
+	uint8_t word[4];
+
+	for (unsigned b = 0; b < 256; b++)
+	{
+		word[0] = (uint8_t)b;
+		Check(e, word, 1, 0);
+	}
+
+	// Value v in lane l, every value w in the other lanes
+	for (unsigned l = 0; l < 4; l++)
+	{
+		for (unsigned v = 0; v < 256; v++)
+		{
+			for (unsigned w = 0; w < 256; w++)
+			{
+				std::memset(word, (int)w, sizeof(word));
+				word[l] = (uint8_t)v;
+				Check(e, word, sizeof(word), 0);
+			}
+		}
+	}
+}
+
+void CheckRandom(Encoder &e, const Options &opt)
+{
+	std::mt19937 rng(opt.seed);
+	std::vector<uint8_t> buf(opt.max_len + 4);
+
+	for (unsigned len = 0; len <= opt.max_len; len++)
+	{
+		for (unsigned align = 0; align < 4; align++)
+		{
+			for (unsigned r = 0; r < opt.rounds; r++)
+			{
+				for (uint8_t &b : buf)
+				{
+					b = (uint8_t)rng();
+				}
+				Check(e, buf.data() + align, len, (align + r) & 3);
+			}
+		}
+	}
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: hex_check [options]\n"
+			"  --seed N            random sequence (1)\n"
+			"  --max-len N         longest random buffer (300)\n"
+			"  --rounds N          buffers per length and alignment (20)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--max-len") opt.max_len = (unsigned)value();
+		else if (arg == "--rounds") opt.rounds = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	Encoder encoders[] = {
+		{ "HEX_EncodeSwar_upper", EncodeSwarUpper, false, 0, 0 },
+		{ "HEX_EncodeSwar_lower", EncodeSwarLower, true, 0, 0 },
+		{ "HEX_Encode", HEX_Encode, false, 0, 0 },
+		{ "HEX_EncodeNibble", HEX_EncodeNibble, false, 0, 0 },
+	};
+	unsigned long failures = 0;
+
+	for (Encoder &e : encoders)
+	{
+		CheckBytes(e);
+		CheckRandom(e, opt);
+		std::printf("hex,%s,%lu,%lu\n", e.name, e.cases, e.failures);
+		failures += e.failures;
+	}
+
+	if (failures)
+	{
+		std::printf("hex,FAILED,%lu\n", failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,446 @@
+//-----------------------------------------------------------------------------
+//! \file idle_sim.cpp
+//!
+//! Host test of the tickless idle manager (idle.h) on a simulated clock.
+//!
+//! The clock counts microseconds and starts shortly before it wraps. A set
+//! of periodic timers restart themselves from their callbacks, some are
+//! stopped and restarted at random, and random external interrupts end
+//! sleeps early. Every main loop pass costs a fixed awake time. Sleeping
+//! advances the clock to the programmed wakeup or the next interrupt,
+//! whichever comes first.
+//!
+//! The test fails if a timer fires before its deadline or later than one
+//! main loop pass after it, if timers fire out of deadline order, or if the
+//! manager sleeps with a timer armed but no wakeup programmed. Timers with
+//! the same deadline, started while they land on different levels of the
+//! wheel, must expire in start order. The sleep of
+//! the port checks the pending predicate first, as the device does with
+//! interrupts masked; a separate check makes sure that work posted, or a
+//! wakeup passed, just before that point prevents the sleep. The number
+//! of wakeups is compared with a periodic tick of RTE_SW_TIMER_RESOLUTION:
+//!
+//!     idle_sim,duration_ms,timers,fired,max_late_us,wakeups,tick_wakeups
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "idle.h"
+}
+
+namespace {
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned duration_ms = 60000;
+	unsigned timers = 8;
+	unsigned max_period_ms = 500;
+	unsigned irq_ms = 250;          // mean interval of external interrupts
+	unsigned work_us = 50;          // awake time of one main loop pass
+	unsigned max_wakeup_ms = 40;    // longest one-shot of the simulated timer
+	unsigned tick_us = 1000;        // RTE_SW_TIMER_RESOLUTION
+};
+
+uint32_t sim_now;
+bool wake_set;
+uint32_t wake_at;
+uint32_t next_irq;
+unsigned failures;
+std::function<void()> before_mask;  // interrupt between IDLE_Sleep and the mask
+
+uint32_t SimNow()
+{
+	return sim_now;
+}
+
+void SimSetWakeup(uint32_t ticks)
+{
+	wake_set = ticks != 0;
+	wake_at = sim_now + ticks;
+}
+
+bool SimSleep(IDLE_PendingFunc pending, void *arg)
+{
+	uint32_t until = next_irq;
+
+	if (before_mask)
+	{
+		before_mask();
+	}
+	if (pending(arg))
+	{
+		return false;
+	}
+
+	if (wake_set && (int32_t)(wake_at - until) < 0)
+	{
+		until = wake_at;
+	}
+	if ((int32_t)(until - sim_now) > 0)
+	{
+		sim_now = until;
+	}
+	wake_set = false;
+	return true;
+}
+
+IDLE_Port sim_port = { SimNow, SimSetWakeup, SimSleep, 0 };
+
+void Fail(const std::string &why)
+{
+	if (failures++ < 10)
+	{
+		std::fprintf(stderr, "idle_sim: %s\n", why.c_str());
+	}
+}
+
+struct SimTimer {
+	IDLE_Timer timer;
+	IDLE_Manager *idle;
+	uint32_t period;
+	uint32_t expected;
+	uint32_t work;
+	unsigned fired;
+};
+
+uint32_t last_deadline;
+bool have_last;
+uint32_t max_late;
+
+void SimExpired(void *arg)
+{
+	SimTimer *t = static_cast<SimTimer *>(arg);
+	int32_t late = (int32_t)(sim_now - t->expected);
+
+	if (late < 0)
+	{
+		Fail("timer fired " + std::to_string(-late) + " us early");
+	}
+	else
+	{
+		if ((uint32_t)late > t->work)
+		{
+			Fail("timer fired " + std::to_string(late) + " us late");
+		}
+		if ((uint32_t)late > max_late)
+		{
+			max_late = (uint32_t)late;
+		}
+	}
+	if (have_last && (int32_t)(t->expected - last_deadline) < 0)
+	{
+		Fail("timers fired out of deadline order");
+	}
+	last_deadline = t->expected;
+	have_last = true;
+
+	t->fired++;
+	t->expected = sim_now + t->period;
+	IDLE_TimerStart(t->idle, &t->timer, t->period);
+}
+
+void CheckNextDeadline()
+{
+	IDLE_Manager m;
+	IDLE_Timer a;
+	IDLE_Timer b;
+	uint32_t delay = 1;
+
+	sim_now = 0xfffffff0u;
+	IDLE_Init(&m, &sim_port);
+	IDLE_TimerInit(&a, SimExpired, nullptr);
+	IDLE_TimerInit(&b, SimExpired, nullptr);
+	if (IDLE_NextDeadline(&m, sim_now, &delay))
+	{
+		Fail("deadline reported with no timer armed");
+	}
+
+	// b expires after the clock wraps, a before
+	IDLE_TimerStart(&m, &b, 0x20);
+	IDLE_TimerStart(&m, &a, 0x08);
+	if (!IDLE_NextDeadline(&m, sim_now, &delay) || delay != 0x08)
+	{
+		Fail("wrong earliest deadline across the wrap");
+	}
+	if (!IDLE_NextDeadline(&m, sim_now + 0x10, &delay) || delay != 0)
+	{
+		Fail("passed deadline not reported as due");
+	}
+	IDLE_TimerStop(&m, &a);
+	if (!IDLE_NextDeadline(&m, sim_now, &delay) || delay != 0x20 || a.armed)
+	{
+		Fail("stopped timer still armed");
+	}
+	IDLE_TimerStop(&m, &b);
+	IDLE_TimerStop(&m, &b);
+	if (IDLE_NextDeadline(&m, sim_now, &delay))
+	{
+		Fail("deadline reported after all timers were stopped");
+	}
+}
+
+std::vector<int> order;
+
+void OrderExpired(void *arg)
+{
+	order.push_back((int)(intptr_t)arg);
+}
+
+// Equal deadlines from different levels of the wheel expire in start order
+void CheckEqualDeadlines()
+{
+	IDLE_Manager m;
+	IDLE_Timer t[6];
+	uint32_t deadline;
+	uint32_t delay;
+	const std::vector<int> want = { 5, 0, 2, 3, 4, 1 };
+
+	sim_now = 0xfffff000u;
+	IDLE_Init(&m, &sim_port);
+	for (int i = 0; i < 6; i++)
+	{
+		IDLE_TimerInit(&t[i], OrderExpired, (void *)(intptr_t)i);
+	}
+	deadline = sim_now + 0x10010;
+	IDLE_TimerStart(&m, &t[0], deadline - sim_now);
+	sim_now += 0x8000;
+	IDLE_RunExpired(&m);
+	IDLE_TimerStart(&m, &t[1], deadline - sim_now);
+	sim_now = deadline - 0x100;
+	IDLE_RunExpired(&m);
+	IDLE_TimerStart(&m, &t[2], deadline - sim_now);
+	IDLE_TimerStart(&m, &t[3], deadline - sim_now);
+	// Moves the others down to level 0, where these are added directly
+	sim_now = deadline - 0x04;
+	IDLE_RunExpired(&m);
+	IDLE_TimerStart(&m, &t[4], deadline - sim_now);
+	IDLE_TimerStart(&m, &t[1], deadline - sim_now);
+	IDLE_TimerStart(&m, &t[5], deadline - 1 - sim_now);
+	if (!IDLE_NextDeadline(&m, sim_now, &delay) || delay != 0x03)
+	{
+		Fail("wrong deadline with timers on several levels");
+	}
+
+	order.clear();
+	sim_now = deadline;
+	IDLE_RunExpired(&m);
+	if (order != want)
+	{
+		Fail("equal deadlines not expired in start order");
+	}
+}
+
+bool work_posted;
+
+bool SimPending(void *)
+{
+	return work_posted;
+}
+
+void CheckPendingBeforeSleep()
+{
+	IDLE_Manager m;
+	IDLE_Timer a;
+	uint32_t start;
+
+	sim_now = 0xffffff00u;
+	next_irq = sim_now + 100000u;
+	sim_port.max_wakeup = 0x1000;
+	IDLE_Init(&m, &sim_port);
+	IDLE_SetPending(&m, SimPending, nullptr);
+	IDLE_TimerInit(&a, [](void *) {}, nullptr);
+	IDLE_TimerStart(&m, &a, 0x200);
+
+	// An interrupt posts work after the main loop looked, before the mask
+	work_posted = false;
+	before_mask = []() { work_posted = true; };
+	start = sim_now;
+	IDLE_Sleep(&m);
+	if (sim_now != start || m.sleeps != 0 || m.skipped != 1)
+	{
+		Fail("slept with work posted before the mask");
+	}
+
+	// The wakeup interrupt fires before the mask, nothing else is pending
+	work_posted = false;
+	before_mask = []() { sim_now += 0x300; };
+	IDLE_Sleep(&m);
+	if (m.sleeps != 0 || m.skipped != 2)
+	{
+		Fail("slept after the programmed wakeup had passed");
+	}
+
+	// Nothing pending: sleep until the wakeup
+	before_mask = nullptr;
+	IDLE_RunExpired(&m);
+	IDLE_TimerStart(&m, &a, 0x200);
+	start = sim_now;
+	IDLE_Sleep(&m);
+	if (m.sleeps != 1 || sim_now == start)
+	{
+		Fail("no sleep with nothing pending");
+	}
+	IDLE_SetPending(&m, nullptr, nullptr);
+}
+
+int Run(const Options &opt)
+{
+	std::mt19937 rng(opt.seed);
+	std::exponential_distribution<double> irq_gap(1.0 / (opt.irq_ms * 1000.0));
+	std::vector<SimTimer> timers(opt.timers);
+	IDLE_Manager idle;
+	uint64_t elapsed = 0;
+	unsigned irqs = 0;
+	unsigned fired = 0;
+
+	sim_now = 0u - 5000000u;
+	sim_port.max_wakeup = opt.max_wakeup_ms * 1000u;
+	next_irq = sim_now + (uint32_t)irq_gap(rng) + 1;
+	IDLE_Init(&idle, &sim_port);
+	IDLE_SetPending(&idle, [](void *) { return (int32_t)(sim_now - next_irq) >= 0; }, nullptr);
+
+	for (SimTimer &t : timers)
+	{
+		t.idle = &idle;
+		t.period = 1000u + rng() % (opt.max_period_ms * 1000u);
+		t.work = opt.work_us;
+		t.fired = 0;
+		t.expected = sim_now + t.period;
+		IDLE_TimerInit(&t.timer, SimExpired, &t);
+		IDLE_TimerStart(&idle, &t.timer, t.period);
+	}
+
+	while (elapsed < (uint64_t)opt.duration_ms * 1000u)
+	{
+		uint32_t before = sim_now;
+
+		// One main loop pass: work, expired timers, then sleep
+		sim_now += opt.work_us;
+		have_last = false;
+		IDLE_RunExpired(&idle);
+
+		// Now and then an event handler stops or restarts a timer
+		if (rng() % 64 == 0)
+		{
+			SimTimer &t = timers[rng() % timers.size()];
+			if (rng() % 2)
+			{
+				IDLE_TimerStop(&idle, &t.timer);
+				t.expected = sim_now + t.period;
+				IDLE_TimerStart(&idle, &t.timer, t.period);
+			}
+			else
+			{
+				IDLE_TimerStart(&idle, &t.timer, t.period);
+				t.expected = sim_now + t.period;
+			}
+		}
+
+		IDLE_Sleep(&idle);
+
+		if ((int32_t)(sim_now - next_irq) >= 0)
+		{
+			irqs++;
+			next_irq = sim_now + (uint32_t)irq_gap(rng) + 1;
+		}
+		elapsed += sim_now - before;
+	}
+
+	for (const SimTimer &t : timers)
+	{
+		fired += t.fired;
+		if (t.fired == 0)
+		{
+			Fail("timer never fired");
+		}
+	}
+	if (idle.wakeups_set != idle.sleeps)
+	{
+		Fail("sleep without a wakeup programmed");
+	}
+
+	char line[IDLE_LINE_SIZE];
+	IDLE_FormatStats(line, sizeof(line), &idle, 1000000u);
+	std::fputs(line, stdout);
+	std::printf("idle_sim,%u,%u,%u,%lu,%lu,%llu\n", opt.duration_ms, opt.timers, fired,
+			(unsigned long)max_late, (unsigned long)idle.sleeps,
+			(unsigned long long)(elapsed / opt.tick_us + irqs));
+	return 0;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: idle_sim [options]\n"
+			"  --seed N            random sequence (1)\n"
+			"  --duration-ms N     simulated time (60000)\n"
+			"  --timers N          periodic timers (8)\n"
+			"  --max-period-ms N   longest timer period (500)\n"
+			"  --irq-ms N          mean interval of external interrupts (250)\n"
+			"  --work-us N         awake time of one main loop pass (50)\n"
+			"  --max-wakeup-ms N   longest one-shot wakeup (40)\n"
+			"  --tick-us N         period of the tick compared against (1000)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--duration-ms") opt.duration_ms = (unsigned)value();
+		else if (arg == "--timers") opt.timers = (unsigned)value();
+		else if (arg == "--max-period-ms") opt.max_period_ms = (unsigned)value();
+		else if (arg == "--irq-ms") opt.irq_ms = (unsigned)value();
+		else if (arg == "--work-us") opt.work_us = (unsigned)value();
+		else if (arg == "--max-wakeup-ms") opt.max_wakeup_ms = (unsigned)value();
+		else if (arg == "--tick-us") opt.tick_us = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.timers == 0 || opt.max_period_ms == 0 || opt.irq_ms == 0 ||
+			opt.max_wakeup_ms == 0 || opt.tick_us == 0)
+	{
+		Usage();
+		return 2;
+	}
+
+	CheckNextDeadline();
+	CheckEqualDeadlines();
+	CheckPendingBeforeSleep();
+	Run(opt);
+	if (failures)
+	{
+		std::printf("idle_sim,FAILED,%u\n", failures);
+		return 1;
+	}
+	return 0;
+}
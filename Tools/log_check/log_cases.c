@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+//! \file log_cases.c
+//!
+//! Log calls of the log_check host test.
+//!
+//! Every case writes one record with the real LOG macro (log.c built with
+//! HOST_BUILD) and reports the text printf produces for the same format
+//! and arguments, which the decoded record must reproduce. Written in C
+//! because LOG relies on C11 _Generic. LOG rejects long arguments where
+//! long is 64 bits, so the %l and %z cases only build on 32-bit targets.
+//-----------------------------------------------------------------------------
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "log.h"
+
+/* Log fmt and expect the snprintf text of the same call */
+#define CASE(fmt, ...) \
+	do { \
+		LOG(fmt, ##__VA_ARGS__); \
+		snprintf(text, sizeof(text), fmt, ##__VA_ARGS__); \
+		expect(fmt, text); \
+		cases++; \
+	} while (0)
+
+enum log_check_state
+{
+	STATE_IDLE,
+	STATE_RUNNING = 7
+};
+
+static const char device_name[] = "RSL10";
+
+unsigned LOG_CheckRun(void (*expect)(const char *fmt, const char *text))
+{
+	static const char *const names[] = { "printf", "SEGGER_RTT_Write", "" };
+	char text[256];
+	unsigned cases = 0;
+	const int ints[] = { 0, 1, -1, 1000, -1000, INT32_MAX, INT32_MIN };
+	const uint32_t words[] = { 0, 1, 0x7f, 0x8000, 0xdeadbeef, UINT32_MAX };
+
+	for (unsigned i = 0; i < sizeof(ints) / sizeof(ints[0]); i++)
+	{
+		int v = ints[i];
+		CASE("%d", v);
+		CASE("[%6i] [%-6d] [%06d] [%+d] [% d]", v, v, v, v, v);
+		CASE("%.4d|%8.3d", v, v);
+#if __SIZEOF_LONG__ == 4
+		CASE("%ld", (long)v);
+#endif
+	}
+	for (unsigned i = 0; i < sizeof(words) / sizeof(words[0]); i++)
+	{
+		uint32_t v = words[i];
+		CASE("%u", (unsigned)v);
+		CASE("%x %X %o", (unsigned)v, (unsigned)v, (unsigned)v);
+		CASE("%#x %#o %08X %-10x|", (unsigned)v, (unsigned)v, (unsigned)v, (unsigned)v);
+#if __SIZEOF_LONG__ == 4
+		CASE("%lu 0x%08lx", (unsigned long)v, (unsigned long)v);
+		CASE("%zu", (size_t)v);
+#endif
+	}
+
+	/* Narrow argument types */
+	{
+		char c = 'R';
+		signed char sc = -100;
+		unsigned char uc = 200;
+		short s = -12345;
+		unsigned short us = 54321;
+		uint8_t u8 = 0xfe;
+		int16_t i16 = -2;
+		bool flag = true;
+		enum log_check_state state = STATE_RUNNING;
+
+		CASE("%c [%3c] [%-3c]", c, c, c);
+		CASE("%hhd %hhu %hhx", sc, uc, uc);
+		CASE("%hd %hu %hx", s, us, us);
+		CASE("%u %d %d", u8, i16, flag);
+		CASE("state %d", state);
+		CASE("%hd", 70000);
+		CASE("%hhu", 300);
+	}
+
+	/* Strings from the ELF image */
+	for (unsigned i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+	{
+		CASE("backend %s", names[i]);
+		CASE("[%20s] [%-20s] [%.6s]", names[i], names[i], names[i]);
+	}
+	CASE("%s on %s", "literal", device_name);
+
+	/* No argument, %% and the maximum number of arguments */
+	CASE("plain record\n");
+	CASE("100%% done, %d%%", 99);
+	CASE("%d %u %x %c %s %hhd %hd %o", -1, 2u, 0x33u, 'd', "five", (signed char)6, (short)-7, 8u);
+
+	/* %p is printed as 0x%08x by the decoder, not in glibc's style */
+	{
+		const void *p = device_name;
+		LOG("at %p", p);
+		snprintf(text, sizeof(text), "at 0x%08x", (unsigned)(uintptr_t)p);
+		expect("at %p", text);
+		cases++;
+	}
+
+	return cases;
+}
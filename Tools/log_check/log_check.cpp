@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+//! \file log_check.cpp
+//!
+//! End to end host test of the tokenized logger (log.h, log.c built with
+//! HOST_BUILD) and its decoder (log_decode/log_decode.h).
+//!
+//! The cases in log_cases.c write their records through the real LOG macro
+//! and LOG_Write, which writes to stdout on the host; stdout is redirected
+//! to a temporary file meanwhile. The records are then decoded against the
+//! rtt_log_fmt section and the strings of this program's own ELF file and
+//! each text is compared with the snprintf output of the same call. Link
+//! with -no-pie so the %s addresses fit 32 bits and match the ELF file.
+//!
+//! Prints one line:
+//!
+//!     log,cases,records,failures
+//!
+//! The exit status is 1 if a record is missing or differs.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "log_decode.h"
+
+extern "C" {
+#include "log.h"
+
+/** Run the log cases, expect() gets the printf text of each record */
+unsigned LOG_CheckRun(void (*expect)(const char *fmt, const char *text));
+}
+
+namespace {
+
+struct Expected {
+	std::string fmt;
+	std::string text;
+};
+
+std::vector<Expected> expected;
+
+void Expect(const char *fmt, const char *text)
+{
+	expected.push_back({ fmt, text });
+}
+
+// Run the cases with stdout redirected, return the records written
+bool Capture(std::string &records)
+{
+	std::FILE *tmp = std::tmpfile();
+	int saved = dup(STDOUT_FILENO);
+
+	if (!tmp || saved < 0)
+	{
+		return false;
+	}
+
+	std::fflush(stdout);
+	dup2(fileno(tmp), STDOUT_FILENO);
+	LOG_Initialize();
+	LOG_CheckRun(Expect);
+	std::fflush(stdout);
+	dup2(saved, STDOUT_FILENO);
+	close(saved);
+
+	std::rewind(tmp);
+	char buf[4096];
+	size_t n;
+	while ((n = std::fread(buf, 1, sizeof(buf), tmp)) > 0)
+	{
+		records.append(buf, n);
+	}
+	std::fclose(tmp);
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	logdec::ElfImage elf;
+	if (!elf.Load("/proc/self/exe"))
+	{
+		std::printf("log,ERROR,cannot read /proc/self/exe\n");
+		return 1;
+	}
+	const logdec::Section *fmt = elf.Find("rtt_log_fmt");
+	if (!fmt || (uintptr_t)__start_rtt_log_fmt > UINT32_MAX || fmt->addr != (uintptr_t)__start_rtt_log_fmt)
+	{
+		std::printf("log,ERROR,link the test with -no-pie\n");
+		return 1;
+	}
+
+	std::string records;
+	if (!Capture(records))
+	{
+		std::printf("log,ERROR,cannot redirect stdout\n");
+		return 1;
+	}
+
+	std::vector<std::string> decoded;
+	std::istringstream in(records);
+	logdec::DecodeResult r = logdec::Decode(elf, *fmt, in, [&](const std::string &text) {
+		decoded.push_back(text);
+	}, stdout);
+
+	unsigned long failures = r.unknown + (r.truncated ? 1 : 0);
+	for (size_t i = 0; i < expected.size(); i++)
+	{
+		const std::string got = i < decoded.size() ? decoded[i] : "<no record>";
+		if (got != expected[i].text)
+		{
+			if (failures++ < 10)
+			{
+				std::printf("log,ERROR,\"%s\": got '%s' want '%s'\n", expected[i].fmt.c_str(),
+						got.c_str(), expected[i].text.c_str());
+			}
+		}
+	}
+	if (decoded.size() > expected.size())
+	{
+		failures += decoded.size() - expected.size();
+	}
+
+	std::printf("log,%zu,%zu,%lu\n", expected.size(), decoded.size(), failures);
+	if (failures)
+	{
+		std::printf("log,FAILED,%lu\n", failures);
+		return 1;
+	}
+	return 0;
+}
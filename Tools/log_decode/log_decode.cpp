@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+//! \file log_decode.cpp
+//!
+//! Host side decoder for the tokenized logger (DataTransfer_RTT/include/log.h).
+//!
+//! Loads the format strings from the rtt_log_fmt section of the firmware ELF
+//! file, reads the binary records captured from the log RTT channel (file
+//! or stdin) and prints the text printf would have produced. %s arguments
+//! are resolved from the allocated sections of the same ELF file. The
+//! decoding itself is in log_decode.h.
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "log_decode.h"
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "usage: log_decode firmware.elf [capture]\n");
+		return 2;
+	}
+
+	logdec::ElfImage elf;
+	if (!elf.Load(argv[1]))
+	{
+		std::fprintf(stderr, "log_decode: cannot read ELF file %s\n", argv[1]);
+		return 2;
+	}
+	const logdec::Section *fmt = elf.Find("rtt_log_fmt");
+	if (!fmt)
+	{
+		std::fprintf(stderr, "log_decode: %s has no rtt_log_fmt section\n", argv[1]);
+		return 2;
+	}
+
+	std::ifstream file;
+	std::istream *in = &std::cin;
+	if (argc == 3)
+	{
+		file.open(argv[2], std::ios::binary);
+		if (!file)
+		{
+			std::fprintf(stderr, "log_decode: cannot open %s\n", argv[2]);
+			return 2;
+		}
+		in = &file;
+	}
+
+	logdec::DecodeResult r = logdec::Decode(elf, *fmt, *in, [](const std::string &text) {
+		std::fwrite(text.data(), 1, text.size(), stdout);
+	}, stderr);
+
+	return (r.truncated || r.unknown) ? 1 : 0;
+}
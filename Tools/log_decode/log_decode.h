@@ -0,0 +1,293 @@
+//-----------------------------------------------------------------------------
+//! \file log_decode.h
+//!
+//! Decoder of the tokenized logger records (DataTransfer_RTT/include/log.h),
+//! shared by the log_decode tool and the host tests.
+//!
+//! ElfImage reads the section table of the firmware ELF file, Format expands
+//! one record the way printf would have and Decode turns a captured record
+//! stream back into text.
+//-----------------------------------------------------------------------------
+#ifndef LOG_DECODE_H_
+#define LOG_DECODE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <istream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace logdec {
+
+struct Section {
+	std::string name;
+	uint32_t type = 0;
+	uint64_t flags = 0;
+	uint64_t addr = 0;
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+// Minimal little endian ELF32/ELF64 section reader
+class ElfImage {
+public:
+	bool Load(const std::string &path)
+	{
+		std::ifstream f(path, std::ios::binary);
+		if (!f)
+		{
+			return false;
+		}
+		data_.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+		if (data_.size() < 52 || std::memcmp(data_.data(), "\x7f" "ELF", 4) != 0 || data_[5] != 1)
+		{
+			return false;
+		}
+
+		bool is64 = data_[4] == 2;
+		uint64_t shoff = is64 ? U64(0x28) : U32(0x20);
+		uint32_t shentsize = U16(is64 ? 0x3a : 0x2e);
+		uint32_t shnum = U16(is64 ? 0x3c : 0x30);
+		uint32_t shstrndx = U16(is64 ? 0x3e : 0x32);
+
+		for (uint32_t i = 0; i < shnum; i++)
+		{
+			uint64_t h = shoff + (uint64_t)i * shentsize;
+			if (h + shentsize > data_.size())
+			{
+				return false;
+			}
+			Section s;
+			s.name = std::to_string(U32(h));     // resolved below
+			s.type = U32(h + 4);
+			s.flags = is64 ? U64(h + 8) : U32(h + 8);
+			s.addr = is64 ? U64(h + 0x10) : U32(h + 0x0c);
+			s.offset = is64 ? U64(h + 0x18) : U32(h + 0x10);
+			s.size = is64 ? U64(h + 0x20) : U32(h + 0x14);
+			sections_.push_back(s);
+		}
+
+		if (shstrndx >= sections_.size())
+		{
+			return false;
+		}
+		const Section &names = sections_[shstrndx];
+		for (Section &s : sections_)
+		{
+			uint64_t off = names.offset + std::stoul(s.name);
+			s.name = (off < data_.size()) ? CString(off) : std::string();
+		}
+		return true;
+	}
+
+	const Section *Find(const std::string &name) const
+	{
+		for (const Section &s : sections_)
+		{
+			if (s.name == name)
+			{
+				return &s;
+			}
+		}
+		return nullptr;
+	}
+
+	// String stored at a target address in an allocated, loaded section
+	bool StringAt(uint64_t addr, std::string &out) const
+	{
+		const uint32_t SHT_NOBITS = 8;
+		const uint64_t SHF_ALLOC = 2;
+
+		for (const Section &s : sections_)
+		{
+			if ((s.flags & SHF_ALLOC) && s.type != SHT_NOBITS &&
+					addr >= s.addr && addr < s.addr + s.size)
+			{
+				out = CString(s.offset + (addr - s.addr));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	std::string CString(uint64_t off) const
+	{
+		std::string s;
+		while (off < data_.size() && data_[off] != 0)
+		{
+			s.push_back((char)data_[off++]);
+		}
+		return s;
+	}
+
+private:
+	uint32_t U16(uint64_t o) const { return data_[o] | data_[o + 1] << 8; }
+	uint32_t U32(uint64_t o) const { return U16(o) | (uint32_t)U16(o + 2) << 16; }
+	uint64_t U64(uint64_t o) const { return U32(o) | (uint64_t)U32(o + 4) << 32; }
+
+	std::vector<uint8_t> data_;
+	std::vector<Section> sections_;
+};
+
+// Expand one record the way printf would have
+inline std::string Format(const ElfImage &elf, const std::string &fmt, const std::vector<uint32_t> &args)
+{
+	std::string out;
+	size_t next = 0;
+	char buf[256];
+
+	for (size_t i = 0; i < fmt.size(); i++)
+	{
+		if (fmt[i] != '%')
+		{
+			out.push_back(fmt[i]);
+			continue;
+		}
+
+		// Flags, width and precision are passed on. Every argument was sent
+		// as 32 bits, so only h and hh are kept (they narrow the value the
+		// way the target printf would); the other length modifiers are dropped.
+		std::string spec = "%";
+		std::string narrow;
+		size_t j = i + 1;
+		while (j < fmt.size() && std::strchr("-+ #0123456789.", fmt[j]))
+		{
+			spec.push_back(fmt[j++]);
+		}
+		while (j < fmt.size() && std::strchr("hlLqjzt", fmt[j]))
+		{
+			if (fmt[j] == 'h')
+			{
+				narrow.push_back('h');
+			}
+			j++;
+		}
+		if (j >= fmt.size())
+		{
+			out += fmt.substr(i);
+			break;
+		}
+
+		char conv = fmt[j];
+		i = j;
+		if (conv == '%')
+		{
+			out.push_back('%');
+			continue;
+		}
+		if (next >= args.size())
+		{
+			out += "<missing>";
+			continue;
+		}
+
+		uint32_t v = args[next++];
+		std::string number = spec + narrow + conv;
+		spec.push_back(conv);
+		switch (conv)
+		{
+		case 'd':
+		case 'i':
+			std::snprintf(buf, sizeof(buf), number.c_str(), (int)(int32_t)v);
+			break;
+		case 'u':
+		case 'x':
+		case 'X':
+		case 'o':
+			std::snprintf(buf, sizeof(buf), number.c_str(), (unsigned)v);
+			break;
+		case 'c':
+			std::snprintf(buf, sizeof(buf), spec.c_str(), (unsigned)v);
+			break;
+		case 'p':
+			std::snprintf(buf, sizeof(buf), "0x%08x", (unsigned)v);
+			break;
+		case 's':
+		{
+			std::string s;
+			if (!elf.StringAt(v, s))
+			{
+				s = "<str@" + std::to_string(v) + ">";
+			}
+			std::snprintf(buf, sizeof(buf), spec.c_str(), s.c_str());
+			break;
+		}
+		default:
+			std::snprintf(buf, sizeof(buf), "<%%%c?>", conv);
+			break;
+		}
+		out += buf;
+	}
+
+	return out;
+}
+
+inline bool ReadWord(std::istream &in, uint32_t &w)
+{
+	uint8_t b[4];
+	if (!in.read((char *)b, 4))
+	{
+		return false;
+	}
+	w = b[0] | b[1] << 8 | b[2] << 16 | (uint32_t)b[3] << 24;
+	return true;
+}
+
+// Result of Decode
+struct DecodeResult {
+	unsigned records = 0;       // records expanded
+	unsigned unknown = 0;       // tokens outside the format section
+	bool truncated = false;     // stream ended inside a record
+};
+
+// Expand every record of in with the format strings of section fmt and pass
+// the text to out. Problems are also reported on diag unless it is NULL.
+inline DecodeResult Decode(const ElfImage &elf, const Section &fmt, std::istream &in,
+		const std::function<void(const std::string &)> &out, std::FILE *diag)
+{
+	DecodeResult result;
+	uint32_t token;
+
+	while (ReadWord(in, token))
+	{
+		uint32_t offset = token & 0x00ffffff;
+		unsigned count = token >> 24;
+		std::vector<uint32_t> args(count);
+
+		for (uint32_t &a : args)
+		{
+			if (!ReadWord(in, a))
+			{
+				if (diag)
+				{
+					std::fprintf(diag, "log_decode: truncated record\n");
+				}
+				result.truncated = true;
+				return result;
+			}
+		}
+
+		if (offset >= fmt.size)
+		{
+			if (diag)
+			{
+				std::fprintf(diag, "log_decode: unknown token 0x%08x\n", token);
+			}
+			result.unknown++;
+			continue;
+		}
+
+		out(Format(elf, elf.CString(fmt.offset + offset), args));
+		result.records++;
+	}
+
+	return result;
+}
+
+} // namespace logdec
+
+#endif /* LOG_DECODE_H_ */
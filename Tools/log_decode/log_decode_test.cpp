@@ -0,0 +1,261 @@
+//-----------------------------------------------------------------------------
+//! \file log_decode_test.cpp
+//!
+//! Host test of the log record decoder (log_decode.h).
+//!
+//! format: every conversion the logger accepts (d i u x X o c p s %) with
+//!     flags, width, precision and length modifiers is expanded by Format
+//!     and compared with snprintf of the original, typed arguments. The
+//!     arguments are passed as the 32-bit words LOG_ARG would have sent.
+//!     %s strings and the rtt_log_fmt section are looked up in the test's
+//!     own ELF file, so it must be linked with -no-pie (addresses below
+//!     4 GiB and equal to the ELF addresses).
+//! edge: missing arguments, unknown conversions, a trailing %, unresolved
+//!     %s and %p, whose text is fixed by the decoder.
+//! stream: a record stream with string arguments, an unknown token and a
+//!     truncated record is fed to Decode.
+//!
+//! One line is printed per group:
+//!
+//!     logdec,group,cases,failures
+//!
+//! The exit status is 1 if any case failed.
+//-----------------------------------------------------------------------------
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "log_decode.h"
+
+// Format strings of the stream test, placed like the LOG macro does
+extern "C" const char __start_rtt_log_fmt[];
+__attribute__((section("rtt_log_fmt"), used)) static const char fmt_pair[] = "pair %s=%d\n";
+__attribute__((section("rtt_log_fmt"), used)) static const char fmt_plain[] = "plain\n";
+__attribute__((section("rtt_log_fmt"), used)) static const char fmt_hex[] = "hex %08lx %hu\n";
+
+namespace {
+
+struct Group {
+	const char *name;
+	unsigned long cases;
+	unsigned long failures;
+};
+
+logdec::ElfImage elf;
+
+void Check(Group &g, const std::string &what, const std::string &got, const std::string &want)
+{
+	g.cases++;
+	if (got != want)
+	{
+		if (g.failures++ < 10)
+		{
+			std::printf("logdec,ERROR,%s,%s: got '%s' want '%s'\n", g.name, what.c_str(),
+					got.c_str(), want.c_str());
+		}
+	}
+}
+
+// Argument word as LOG_ARG puts it in the record
+template <typename T>
+uint32_t Arg(T v)
+{
+	if constexpr (std::is_pointer<T>::value)
+	{
+		return (uint32_t)(uintptr_t)v;
+	}
+	else
+	{
+		return (uint32_t)v;
+	}
+}
+
+// Format of the encoded arguments must match snprintf of the typed ones
+template <typename... T>
+void Same(Group &g, const char *fmt, T... vals)
+{
+	char want[512];
+	std::snprintf(want, sizeof(want), fmt, vals...);
+	Check(g, fmt, logdec::Format(elf, fmt, { Arg(vals)... }), want);
+}
+
+void Fixed(Group &g, const char *fmt, const std::vector<uint32_t> &args, const char *want)
+{
+	Check(g, fmt, logdec::Format(elf, fmt, args), want);
+}
+
+void CheckFormat(Group &g)
+{
+	const int ints[] = { 0, 1, -1, 42, -42, 123456789, -123456789, INT32_MAX, INT32_MIN };
+	const unsigned uints[] = { 0, 1, 9, 255, 0x8000, 0xdeadbeef, UINT32_MAX };
+	const char *int_fmts[] = {
+		"%d", "%i", "%5d", "%-5d|", "%05d", "%+d", "% d", "%.3d", "%8.3i", "%-+8d|", "%hd", "%hhd",
+	};
+	const char *uint_fmts[] = {
+		"%u", "%x", "%X", "%o", "%#x", "%#X", "%#o", "%08x", "%-10X|", "%.6o", "%10.4x",
+		"%hu", "%hx", "%hhu", "%hhx",
+	};
+
+	for (const char *f : int_fmts)
+	{
+		for (int v : ints)
+		{
+			Same(g, f, v);
+		}
+	}
+	for (const char *f : uint_fmts)
+	{
+		for (unsigned v : uints)
+		{
+			Same(g, f, v);
+		}
+	}
+
+	// 32-bit long, size_t and friends on the target: the value fits a word
+	for (int v : ints)
+	{
+		Same(g, "%ld", (long)v);
+		Same(g, "%+8li", (long)v);
+		Same(g, "%zd", (ptrdiff_t)v);
+		Same(g, "%jd", (intmax_t)v);
+		Same(g, "%td", (ptrdiff_t)v);
+	}
+	for (unsigned v : uints)
+	{
+		Same(g, "%lu", (unsigned long)v);
+		Same(g, "%#lx", (unsigned long)v);
+		Same(g, "%08lX", (unsigned long)v);
+		Same(g, "%zu", (size_t)v);
+		Same(g, "%zx", (size_t)v);
+	}
+	for (int c : { 'A', 'z', '0', ' ', '~' })
+	{
+		Same(g, "%c", c);
+		Same(g, "[%3c]", c);
+		Same(g, "[%-3c]", c);
+	}
+
+	const char *strs[] = { "", "abc", "RSL10", "with spaces and %" };
+	for (const char *s : strs)
+	{
+		Same(g, "%s", s);
+		Same(g, "[%8s]", s);
+		Same(g, "[%-8s]", s);
+		Same(g, "[%.2s]", s);
+		Same(g, "[%6.1s]", s);
+	}
+
+	Same(g, "100%%");
+	Same(g, "%% %d %%", 7);
+	Same(g, "no conversions");
+	Same(g, "%s=%d (%u, 0x%x, %c)\n", "mixed", -3, 3u, 0xabcu, 'm');
+	Same(g, "%d %d %d %d %d %d %d %d", 1, 2, 3, 4, 5, 6, 7, 8);
+}
+
+void CheckEdge(Group &g)
+{
+	Fixed(g, "%p", { 0x20001234 }, "0x20001234");
+	Fixed(g, "%p", { 0 }, "0x00000000");
+	Fixed(g, "%d %d", { 1 }, "1 <missing>");
+	Fixed(g, "%s", {}, "<missing>");
+	Fixed(g, "%% only", {}, "% only");
+	Fixed(g, "%y", { 5 }, "<%y?>");
+	Fixed(g, "a %y b %d", { 5, 6 }, "a <%y?> b 6");
+	Fixed(g, "end %", {}, "end %");
+	Fixed(g, "end %-08l", { 1 }, "end %-08l");
+	Fixed(g, "%s", { 16 }, "<str@16>");
+	Fixed(g, "[%8s]", { 16 }, "[<str@16>]");
+	Fixed(g, "%d", { 1, 2 }, "1");
+}
+
+std::string Word(uint32_t w)
+{
+	char b[4] = { (char)w, (char)(w >> 8), (char)(w >> 16), (char)(w >> 24) };
+	return std::string(b, 4);
+}
+
+uint32_t Token(const char *fmt, unsigned nargs)
+{
+	return (uint32_t)nargs << 24 | (uint32_t)(fmt - __start_rtt_log_fmt);
+}
+
+void CheckStream(Group &g, const logdec::Section &fmt)
+{
+	static const char key[] = "speed";
+	std::string records;
+	std::vector<std::string> text;
+	auto collect = [&](const std::string &t) { text.push_back(t); };
+
+	Check(g, "section address", std::to_string(fmt.addr),
+			std::to_string((uintptr_t)__start_rtt_log_fmt));
+
+	records += Word(Token(fmt_pair, 2)) + Word(Arg(key)) + Word(Arg(-12));
+	records += Word(Token(fmt_plain, 0));
+	records += Word((uint32_t)fmt.size);          // unknown token, no arguments
+	records += Word(Token(fmt_hex, 2)) + Word(0x1234abcd) + Word(0x10005);
+	records += Word(Token(fmt_plain, 0));
+
+	std::istringstream in(records);
+	logdec::DecodeResult r = logdec::Decode(elf, fmt, in, collect, nullptr);
+	Check(g, "records", std::to_string(r.records), "4");
+	Check(g, "unknown", std::to_string(r.unknown), "1");
+	Check(g, "truncated", std::to_string(r.truncated), "0");
+	text.resize(4);
+	Check(g, "record 0", text[0], "pair speed=-12\n");
+	Check(g, "record 1", text[1], "plain\n");
+	Check(g, "record 2", text[2], "hex 1234abcd 5\n");
+	Check(g, "record 3", text[3], "plain\n");
+
+	// A record cut off inside its arguments ends the stream
+	text.clear();
+	std::istringstream cut(Word(Token(fmt_plain, 0)) + Word(Token(fmt_pair, 2)) + Word(Arg(key)));
+	r = logdec::Decode(elf, fmt, cut, collect, nullptr);
+	Check(g, "cut records", std::to_string(r.records), "1");
+	Check(g, "cut truncated", std::to_string(r.truncated), "1");
+	Check(g, "cut text", std::to_string(text.size()), "1");
+}
+
+} // namespace
+
+int main()
+{
+	if (!elf.Load("/proc/self/exe"))
+	{
+		std::printf("logdec,ERROR,cannot read /proc/self/exe\n");
+		return 1;
+	}
+	const logdec::Section *fmt = elf.Find("rtt_log_fmt");
+	if (!fmt || (uintptr_t)__start_rtt_log_fmt > UINT32_MAX)
+	{
+		std::printf("logdec,ERROR,link the test with -no-pie\n");
+		return 1;
+	}
+
+	Group groups[] = {
+		{ "format", 0, 0 },
+		{ "edge", 0, 0 },
+		{ "stream", 0, 0 },
+	};
+	unsigned long failures = 0;
+
+	CheckFormat(groups[0]);
+	CheckEdge(groups[1]);
+	CheckStream(groups[2], *fmt);
+
+	for (const Group &g : groups)
+	{
+		std::printf("logdec,%s,%lu,%lu\n", g.name, g.cases, g.failures);
+		failures += g.failures;
+	}
+
+	if (failures)
+	{
+		std::printf("logdec,FAILED,%lu\n", failures);
+		return 1;
+	}
+	return 0;
+}
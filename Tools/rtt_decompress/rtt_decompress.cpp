@@ -0,0 +1,74 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_decompress.cpp
+//!
+//! Host side decompressor for the compressed backends of DataTransfer_RTT.
+//!
+//! Reads a captured RTT bulk channel stream from a file or stdin and
+//! decompresses every "codec,<name>" section with rtt_decompress.h. Frames
+//! lost on the device restart the stream at the sequence gap; a damaged
+//! frame stops decoding until the next codec line.
+//!
+//! Prints one summary line per stream and, with -o, writes the
+//! decompressed bytes to a file.
+//-----------------------------------------------------------------------------
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "rtt_decompress.h"
+
+int main(int argc, char **argv)
+{
+	std::string input;
+	std::string output;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			output = argv[++i];
+		}
+		else if (argv[i][0] == '-' && argv[i][1] != 0)
+		{
+			std::fprintf(stderr, "usage: rtt_decompress [-o raw.bin] [capture]\n");
+			return 2;
+		}
+		else
+		{
+			input = argv[i];
+		}
+	}
+
+	std::ifstream file;
+	std::istream *in = &std::cin;
+	if (!input.empty() && input != "-")
+	{
+		file.open(input, std::ios::binary);
+		if (!file)
+		{
+			std::fprintf(stderr, "rtt_decompress: cannot open %s\n", input.c_str());
+			return 2;
+		}
+		in = &file;
+	}
+
+	std::ofstream raw;
+	if (!output.empty())
+	{
+		raw.open(output, std::ios::binary);
+		if (!raw)
+		{
+			std::fprintf(stderr, "rtt_decompress: cannot create %s\n", output.c_str());
+			return 2;
+		}
+	}
+
+	CRC32_Initialize();
+
+	rttdec::Stream stream(stdout);
+	rttdec::Decompress(stream, *in, raw.is_open() ? &raw : nullptr);
+
+	return stream.Bad() ? 1 : 0;
+}
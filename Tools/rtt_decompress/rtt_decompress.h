@@ -0,0 +1,258 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_decompress.h
+//!
+//! Decompressor of the framed compressed streams of DataTransfer_RTT,
+//! shared by the rtt_decompress tool and its host test.
+//!
+//! A "codec,<lz|rle|none>" line starts a new compressed stream; the framed
+//! lines that follow ("F<seq>:<payload>:<crc>", see frame.h) are checked by
+//! CRC and sequence number and their payload is decompressed with the same
+//! C module the device uses (compress.h).
+//!
+//! The device writes each frame whole or not at all and restarts its
+//! encoder when a write is dropped, so a sequence gap is where the sender
+//! started over: the decoder is reset there and decoding continues with
+//! the next frame. A damaged frame, on the other hand, was sent and the
+//! sender kept its state, so decoding stops until the next codec line.
+//-----------------------------------------------------------------------------
+#ifndef RTT_DECOMPRESS_H_
+#define RTT_DECOMPRESS_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "compress.h"
+#include "crc32.h"
+}
+
+namespace rttdec {
+
+inline int HexValue(char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if (c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+inline bool ParseHex(const std::string &s, std::vector<uint8_t> &out)
+{
+	if (s.size() % 2 != 0)
+	{
+		return false;
+	}
+	out.resize(s.size() / 2);
+	for (size_t i = 0; i < out.size(); i++)
+	{
+		int hi = HexValue(s[2 * i]);
+		int lo = HexValue(s[2 * i + 1]);
+		if (hi < 0 || lo < 0)
+		{
+			return false;
+		}
+		out[i] = (uint8_t)(hi << 4 | lo);
+	}
+	return true;
+}
+
+inline bool ParseU32(const std::string &s, uint32_t &v)
+{
+	std::vector<uint8_t> b;
+	if (s.size() != 8 || !ParseHex(s, b))
+	{
+		return false;
+	}
+	v = (uint32_t)b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3];
+	return true;
+}
+
+// Counters of one "codec,<name>" section
+struct StreamStats {
+	uint64_t frames = 0;        // frames decoded
+	uint64_t lost = 0;          // frames missing at sequence gaps
+	uint64_t resets = 0;        // decoder restarts at those gaps
+	uint64_t wire = 0;          // characters of the decoded frames
+	uint64_t payload = 0;       // compressed bytes
+	uint64_t raw = 0;           // decompressed bytes
+	bool failed = false;        // damaged frame or invalid data, rest skipped
+};
+
+// One "codec,<name>" section of the capture. Summary lines and errors go to
+// report and stderr unless report is NULL.
+class Stream {
+public:
+	explicit Stream(std::FILE *report) : report_(report) {}
+
+	void Start(const std::string &codec)
+	{
+		Finish();
+		codec_ = codec;
+		active_ = codec != "none";
+		stats_ = StreamStats();
+		next_seq_ = 0;
+		COMP_LzDecoderInit(&lz_);
+		COMP_RleInit(&rle_);
+	}
+
+	void Line(const std::string &line, std::ostream *out)
+	{
+		if (!active_ || stats_.failed)
+		{
+			return;
+		}
+
+		uint32_t seq;
+		uint32_t crc;
+		std::vector<uint8_t> payload;
+		size_t colon = line.rfind(':');
+		if (colon == 9 || !ParseU32(line.substr(1, 8), seq) ||
+				!ParseHex(line.substr(10, colon - 10), payload) ||
+				!ParseU32(line.substr(colon + 1), crc))
+		{
+			Fail("malformed frame");
+			return;
+		}
+
+		uint8_t le[4] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24) };
+		uint32_t check = CRC32_Update(CRC32_Update(0, le, sizeof(le)), payload.data(), payload.size());
+		if (check != crc)
+		{
+			Fail("crc error at seq " + std::to_string(seq));
+			return;
+		}
+		if (seq < next_seq_)
+		{
+			Fail("frame " + std::to_string(seq) + " out of order");
+			return;
+		}
+		if (seq != next_seq_)
+		{
+			// The sender restarted its encoder after the lost frames
+			stats_.lost += seq - next_seq_;
+			stats_.resets++;
+			COMP_LzDecoderInit(&lz_);
+			COMP_RleInit(&rle_);
+		}
+		next_seq_ = seq + 1;
+
+		// Far more than the largest payload the device compresses per frame
+		std::vector<uint8_t> raw(65536);
+		int n;
+		if (codec_ == "lz")
+		{
+			n = COMP_LzDecode(&lz_, raw.data(), raw.size(), payload.data(), payload.size());
+		}
+		else if (codec_ == "rle")
+		{
+			n = COMP_RleDecode(&rle_, raw.data(), raw.size(), payload.data(), payload.size());
+		}
+		else
+		{
+			Fail("unknown codec");
+			return;
+		}
+		if (n < 0)
+		{
+			Fail("invalid compressed data at seq " + std::to_string(seq));
+			return;
+		}
+
+		stats_.frames++;
+		stats_.wire += line.size() + 1;
+		stats_.payload += payload.size();
+		stats_.raw += n;
+		if (out)
+		{
+			out->write((const char *)raw.data(), n);
+		}
+	}
+
+	void Finish()
+	{
+		if (!active_)
+		{
+			return;
+		}
+		if (report_)
+		{
+			std::fprintf(report_, "codec,%s,frames=%llu,lost=%llu,resets=%llu,wire=%llu,"
+					"compressed=%llu,raw=%llu,ratio=%.3f%s\n",
+					codec_.c_str(), (unsigned long long)stats_.frames,
+					(unsigned long long)stats_.lost, (unsigned long long)stats_.resets,
+					(unsigned long long)stats_.wire, (unsigned long long)stats_.payload,
+					(unsigned long long)stats_.raw,
+					stats_.raw ? (double)stats_.payload / stats_.raw : 0.0,
+					stats_.failed ? ",FAILED" : "");
+		}
+		bad_ |= stats_.failed;
+		last_ = stats_;
+		active_ = false;
+	}
+
+	bool Bad() const { return bad_; }
+
+	// Counters of the last finished section
+	const StreamStats &Last() const { return last_; }
+
+private:
+	void Fail(const std::string &why)
+	{
+		if (report_)
+		{
+			std::fprintf(stderr, "rtt_decompress: %s stream: %s\n", codec_.c_str(), why.c_str());
+		}
+		stats_.failed = true;
+	}
+
+	std::FILE *report_;
+	std::string codec_;
+	bool active_ = false;
+	bool bad_ = false;
+	uint32_t next_seq_ = 0;
+	StreamStats stats_;
+	StreamStats last_;
+	COMP_LzDecoder lz_;
+	COMP_RleState rle_;
+};
+
+// Feed every codec and frame line of a capture to stream
+inline void Decompress(Stream &stream, std::istream &in, std::ostream *out)
+{
+	std::string line;
+
+	while (std::getline(in, line))
+	{
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		if (line.compare(0, 6, "codec,") == 0)
+		{
+			stream.Start(line.substr(6));
+		}
+		else if (line.size() > 9 && line[0] == 'F' && line[9] == ':')
+		{
+			stream.Line(line, out);
+		}
+	}
+	stream.Finish();
+}
+
+} // namespace rttdec
+
+#endif /* RTT_DECOMPRESS_H_ */
@@ -0,0 +1,299 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_decompress_test.cpp
+//!
+//! Host round trip test of the compressed backends and rtt_decompress.h.
+//!
+//! Payload frames of random length are sent the way Send_Lz and Send_Rle in
+//! main.c do: compressed, framed with FRAME_Encode and written whole or not
+//! at all to a simulated channel that drops frames by a pattern; a dropped
+//! write restarts the encoder. The captured text is decompressed with the
+//! host decoder and must give back exactly the payload of the delivered
+//! frames, with the lost frames counted at the sequence gaps.
+//!
+//! Each codec runs with random, ramp and text payloads, so matches and
+//! deltas reach back across frames, and with these drop patterns: none,
+//! every 7th frame, 10% and 50% at random, a burst, the first frame and
+//! the last ones. Two control cases check the test itself: without the
+//! encoder restart a drop must break the output, and a damaged frame must
+//! stop decoding. One line is printed per case:
+//!
+//!     comp,codec,payload,pattern,sent,delivered,lost,raw_bytes,result
+//!
+//! The exit status is 1 if any case failed.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rtt_decompress.h"
+
+extern "C" {
+#include "frame.h"
+}
+
+namespace {
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned frames = 400;
+	unsigned max_len = 1024;        // BUFF_SIZE of main.c
+};
+
+enum class Payload { Random, Ramp, Text };
+
+const char *PayloadName(Payload p)
+{
+	switch (p)
+	{
+	case Payload::Random:
+		return "random";
+	case Payload::Ramp:
+		return "ramp";
+	default:
+		return "text";
+	}
+}
+
+void Generate(Payload kind, std::mt19937 &rng, std::vector<uint8_t> &buf, unsigned len)
+{
+	static const std::string words[] = { "RSL10 ", "RTT ", "bulk ", "frame ", "seed ", "12345 " };
+
+	buf.clear();
+	while (buf.size() < len)
+	{
+		switch (kind)
+		{
+		case Payload::Random:
+			buf.push_back((uint8_t)rng());
+			break;
+		case Payload::Ramp:
+			buf.push_back((uint8_t)(buf.size() / 3 + (rng() % 16 == 0)));
+			break;
+		case Payload::Text:
+		{
+			const std::string &w = words[rng() % 6];
+			buf.insert(buf.end(), w.begin(), w.end());
+			break;
+		}
+		}
+	}
+	buf.resize(len);
+}
+
+// Sender side of main.c: compress, frame, write whole or drop
+struct Sender {
+	bool lz;
+	bool restart = true;        // false models the old unchecked write
+	COMP_LzEncoder lz_state;
+	COMP_RleState rle_state;
+	uint32_t seq = 0;
+	std::vector<uint8_t> comp;
+	std::vector<char> frame;
+
+	explicit Sender(bool use_lz) : lz(use_lz)
+	{
+		COMP_LzEncoderInit(&lz_state);
+		COMP_RleInit(&rle_state);
+	}
+
+	void Send(const std::vector<uint8_t> &data, bool drop, std::string &capture)
+	{
+		unsigned n;
+
+		comp.resize(COMP_LZ_BOUND(data.size()) + COMP_RLE_BOUND(data.size()));
+		frame.resize(FRAME_ENCODED_SIZE(comp.size()));
+		if (lz)
+		{
+			n = COMP_LzEncode(&lz_state, comp.data(), data.data(), data.size());
+		}
+		else
+		{
+			n = COMP_RleEncode(&rle_state, comp.data(), data.data(), data.size());
+		}
+		n = FRAME_Encode(frame.data(), seq++, comp.data(), n);
+
+		if (!drop)
+		{
+			capture.append(frame.data(), n);
+		}
+		else if (restart)
+		{
+			COMP_LzEncoderInit(&lz_state);
+			COMP_RleInit(&rle_state);
+		}
+	}
+};
+
+struct Pattern {
+	const char *name;
+	std::function<bool(unsigned i, unsigned frames, std::mt19937 &rng)> drop;
+};
+
+struct Case {
+	bool lz;
+	Payload payload;
+	const Pattern *pattern;
+	bool restart;
+	bool damage;                // flip a character of a delivered frame
+};
+
+// Run one case, return true if the result is what the case expects
+bool Run(const Case &c, const Options &opt)
+{
+	std::mt19937 rng(opt.seed);
+	std::mt19937 drops(opt.seed * 31 + 7);
+	Sender sender(c.lz);
+	std::string capture = std::string("codec,") + (c.lz ? "lz" : "rle") + "\n";
+	std::string expected;
+	std::vector<uint8_t> data;
+	unsigned delivered = 0;
+	unsigned lost = 0;
+	unsigned pending = 0;       // dropped since the last delivered frame
+	size_t damaged_at = std::string::npos;
+	size_t expected_before_damage = 0;
+
+	sender.restart = c.restart;
+	for (unsigned i = 0; i < opt.frames; i++)
+	{
+		bool drop = c.pattern->drop(i, opt.frames, drops);
+
+		Generate(c.payload, rng, data, 1 + rng() % opt.max_len);
+		if (c.damage && i == opt.frames / 2 && !drop)
+		{
+			damaged_at = capture.size() + 12;
+			expected_before_damage = expected.size();
+		}
+		sender.Send(data, drop, capture);
+		if (drop)
+		{
+			pending++;
+			continue;
+		}
+		delivered++;
+		lost += pending;
+		pending = 0;
+		expected.append((const char *)data.data(), data.size());
+	}
+	capture += "codec,none\n";
+
+	if (damaged_at != std::string::npos)
+	{
+		capture[damaged_at] = capture[damaged_at] == '0' ? '1' : '0';
+	}
+
+	rttdec::Stream stream(nullptr);
+	std::istringstream in(capture);
+	std::ostringstream out;
+	rttdec::Decompress(stream, in, &out);
+	const rttdec::StreamStats &st = stream.Last();
+
+	bool exact = out.str() == expected && !st.failed && st.frames == delivered && st.lost == lost;
+	bool ok;
+	if (c.damage)
+	{
+		ok = st.failed && damaged_at != std::string::npos &&
+				out.str() == expected.substr(0, expected_before_damage);
+	}
+	else if (!c.restart)
+	{
+		ok = !exact;
+	}
+	else
+	{
+		ok = exact;
+	}
+
+	std::printf("comp,%s,%s,%s%s,%u,%u,%llu,%llu,%s\n", c.lz ? "lz" : "rle", PayloadName(c.payload),
+			c.pattern->name, c.damage ? "+damaged" : (c.restart ? "" : "+no_restart"),
+			opt.frames, delivered, (unsigned long long)st.lost, (unsigned long long)st.raw,
+			ok ? "ok" : "FAIL");
+	return ok;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: rtt_decompress_test [options]\n"
+			"  --seed N            random sequence (1)\n"
+			"  --frames N          frames per case (400)\n"
+			"  --max-len N         largest payload per frame (1024)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--frames") opt.frames = (unsigned)value();
+		else if (arg == "--max-len") opt.max_len = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.frames < 40 || opt.max_len == 0 || opt.max_len > 16384)
+	{
+		Usage();
+		return 2;
+	}
+
+	CRC32_Initialize();
+
+	static const Pattern patterns[] = {
+		{ "none", [](unsigned, unsigned, std::mt19937 &) { return false; } },
+		{ "every7", [](unsigned i, unsigned, std::mt19937 &) { return i % 7 == 6; } },
+		{ "random10", [](unsigned, unsigned, std::mt19937 &r) { return r() % 10 == 0; } },
+		{ "random50", [](unsigned, unsigned, std::mt19937 &r) { return r() % 2 == 0; } },
+		{ "burst", [](unsigned i, unsigned, std::mt19937 &) { return i >= 20 && i < 30; } },
+		{ "first", [](unsigned i, unsigned, std::mt19937 &) { return i == 0; } },
+		{ "last", [](unsigned i, unsigned n, std::mt19937 &) { return i >= n - 3; } },
+	};
+	const Payload payloads[] = { Payload::Random, Payload::Ramp, Payload::Text };
+	unsigned failures = 0;
+
+	for (bool lz : { true, false })
+	{
+		for (Payload p : payloads)
+		{
+			for (const Pattern &pattern : patterns)
+			{
+				failures += !Run({ lz, p, &pattern, true, false }, opt);
+			}
+		}
+		failures += !Run({ lz, Payload::Text, &patterns[1], false, false }, opt);
+		failures += !Run({ lz, Payload::Text, &patterns[0], true, true }, opt);
+	}
+
+	if (failures)
+	{
+		std::printf("comp,FAILED,%u\n", failures);
+		return 1;
+	}
+	return 0;
+}
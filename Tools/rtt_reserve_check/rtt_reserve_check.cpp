@@ -0,0 +1,261 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_reserve_check.cpp
+//!
+//! Exhaustive host test of the zero-copy reserve/commit API (rtt_reserve.h
+//! built with HOST_BUILD).
+//!
+//! For every ring size up to --max-size, every WrOff/RdOff pair and every
+//! request from 0 to SizeOfBuffer + 1 bytes, a reservation is made on the
+//! host stand-in of the up-buffer. It must give min(request, free) bytes
+//! with one byte of the ring kept free, start at WrOff and split into a
+//! second span at offset 0 only at the end of the ring. The reservation is
+//! filled with RTT_SpanWrite in pieces of varying length and committed;
+//! the bytes from the old WrOff on must be the pattern, every other byte
+//! of the ring untouched, WrOff advanced modulo the size and RdOff kept.
+//!
+//! Every whole reservation of an odd length is also filled the way
+//! SendHexFrameZeroCopy does, with RTT_SpanWriteHex and a newline, and
+//! must read back as the hex text of the data. RTT_ReserveFits must hold
+//! for a request exactly when some ring state can reserve all of it.
+//!
+//!     reserve,sizes,cases,wrapped,failures
+//!
+//! The exit status is 1 if any case failed.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "hex_encode.h"
+#include "rtt_reserve.h"
+}
+
+namespace {
+
+struct Options {
+	unsigned max_size = 48;
+};
+
+const char GUARD = '#';         // ring bytes outside the reservation
+
+unsigned long failures;
+
+void Fail(const std::string &what, unsigned size, unsigned wr, unsigned rd, unsigned len)
+{
+	if (failures++ < 10)
+	{
+		std::printf("reserve,ERROR,%s: size %u WrOff %u RdOff %u len %u\n", what.c_str(), size,
+				wr, rd, len);
+	}
+}
+
+struct Ring {
+	std::vector<char> mem;
+	RTT_UpBuffer up;
+
+	Ring(unsigned size, unsigned wr, unsigned rd) : mem(size, GUARD)
+	{
+		up.sName = "check";
+		up.pBuffer = mem.data();
+		up.SizeOfBuffer = size;
+		up.WrOff = wr;
+		up.RdOff = rd;
+		up.Flags = 0;
+	}
+
+	// len bytes of the ring from offset pos on, across the wrap
+	std::string Read(unsigned pos, unsigned len) const
+	{
+		std::string s;
+
+		for (unsigned i = 0; i < len; i++)
+		{
+			s += mem[(pos + i) % mem.size()];
+		}
+		return s;
+	}
+
+	bool GuardsFrom(unsigned pos, unsigned len) const
+	{
+		return Read(pos, len) == std::string(len, GUARD);
+	}
+};
+
+// Free bytes of a ring state, one byte always stays free
+unsigned Free(unsigned size, unsigned wr, unsigned rd)
+{
+	return (rd + size - wr - 1) % size;
+}
+
+// Reserve, check the spans, fill with RTT_SpanWrite, commit and check
+bool CheckCopy(unsigned size, unsigned wr, unsigned rd, unsigned len)
+{
+	Ring ring(size, wr, rd);
+	RTT_Span span;
+	unsigned want = len < Free(size, wr, rd) ? len : Free(size, wr, rd);
+	unsigned got = RTT_ReserveBuffer(&ring.up, len, &span);
+	std::string data;
+
+	if (got != want || span.len[0] + span.len[1] != got)
+	{
+		Fail("reserved " + std::to_string(got) + " bytes, want " + std::to_string(want), size, wr, rd, len);
+		return false;
+	}
+	if (span.ptr[0] != ring.mem.data() + wr || span.ptr[1] != ring.mem.data() ||
+			span.len[0] > size - wr || (span.len[1] != 0 && span.len[0] != size - wr))
+	{
+		Fail("spans not split at the end of the ring", size, wr, rd, len);
+		return false;
+	}
+
+	for (unsigned i = 0; i < got; i++)
+	{
+		data += (char)('a' + (wr + i * 7) % 26);
+	}
+	// Pieces of 1, 2, 3... bytes so that some of them straddle the wrap
+	for (unsigned pos = 0, piece = 1; pos < got; pos += piece, piece++)
+	{
+		unsigned n = (got - pos < piece) ? got - pos : piece;
+		RTT_SpanWrite(&span, pos, data.data() + pos, n);
+	}
+	RTT_CommitBuffer(&ring.up, got);
+
+	if (ring.Read(wr, got) != data || !ring.GuardsFrom((wr + got) % size, size - got))
+	{
+		Fail("committed bytes differ or a byte outside the reservation changed", size, wr, rd, len);
+		return false;
+	}
+	if (ring.up.WrOff != (wr + got) % size || ring.up.RdOff != rd)
+	{
+		Fail("WrOff " + std::to_string(ring.up.WrOff) + " after the commit", size, wr, rd, len);
+		return false;
+	}
+	return true;
+}
+
+// A whole hex frame of len = 2 * n + 1 characters as SendHexFrameZeroCopy writes it
+bool CheckHexFrame(unsigned size, unsigned wr, unsigned rd, unsigned len)
+{
+	Ring ring(size, wr, rd);
+	RTT_Span span;
+	unsigned n = (len - 1) / 2;
+	std::vector<uint8_t> data(n);
+	std::string text(HEX_ENCODED_SIZE(n), '?');
+
+	if (RTT_ReserveBuffer(&ring.up, len, &span) != len)
+	{
+		return true;
+	}
+	for (unsigned i = 0; i < n; i++)
+	{
+		data[i] = (uint8_t)(0x9c + i * 37 + wr);
+	}
+	HEX_EncodeNibble(&text[0], data.data(), n);
+	text += '\n';
+
+	RTT_SpanWriteHex(&span, 0, data.data(), n);
+	RTT_SpanWrite(&span, len - 1, "\n", 1);
+	RTT_CommitBuffer(&ring.up, len);
+
+	if (ring.Read(wr, len) != text || !ring.GuardsFrom((wr + len) % size, size - len))
+	{
+		Fail("hex frame differs", size, wr, rd, len);
+		return false;
+	}
+	return true;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: rtt_reserve_check [options]\n"
+			"  --max-size N        largest ring size checked (48)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--max-size") opt.max_size = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.max_size < 2 || opt.max_size > 1024)
+	{
+		Usage();
+		return 2;
+	}
+
+	unsigned long cases = 0;
+	unsigned long wrapped = 0;
+
+	for (unsigned size = 1; size <= opt.max_size; size++)
+	{
+		std::vector<bool> complete(size + 2, false);
+
+		for (unsigned wr = 0; wr < size; wr++)
+		{
+			for (unsigned rd = 0; rd < size; rd++)
+			{
+				for (unsigned len = 0; len <= size + 1; len++)
+				{
+					CheckCopy(size, wr, rd, len);
+					if (len & 1)
+					{
+						CheckHexFrame(size, wr, rd, len);
+					}
+					cases++;
+
+					if (len <= Free(size, wr, rd))
+					{
+						complete[len] = true;
+						wrapped += wr + len > size;
+					}
+				}
+			}
+		}
+
+		Ring ring(size, 0, 0);
+		for (unsigned len = 0; len <= size + 1; len++)
+		{
+			if (RTT_ReserveFits(&ring.up, len) != complete[len])
+			{
+				Fail("RTT_ReserveFits disagrees with the reservations", size, 0, 0, len);
+			}
+		}
+	}
+
+	std::printf("reserve,%u,%lu,%lu,%lu\n", opt.max_size, cases, wrapped, failures);
+	if (failures)
+	{
+		std::printf("reserve,FAILED,%lu\n", failures);
+		return 1;
+	}
+	return 0;
+}
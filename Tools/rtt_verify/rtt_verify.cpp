@@ -0,0 +1,522 @@
+//-----------------------------------------------------------------------------
+//! \file rtt_verify.cpp
+//!
+//! Host side verifier for the hex frames streamed by DataTransfer_RTT.
+//!
+//! Reads a captured RTT bulk channel (RTT_CH_BULK) byte stream from a file or stdin, checks
+//! every hex frame against the payload regenerated from the seed announced
+//! by the "seed,<n>" line and reports dropped, truncated and corrupted
+//! frames together with the throughput observed while reading.
+//!
+//! The device starts every run with "seed,<n>,<frames>,<repeat>,<label>":
+//! the number of plain hex frames in the run, 1 if they all carry the
+//! first payload, and the backend or test that sends them. A run announced
+//! with 0 frames is not checked. A plain "seed,<n>" line uses --frames and
+//! --repeat instead.
+//!
+//! Framed lines ("F<seq>:<payload>:<crc>", see frame.h) are checked by
+//! their CRC and sequence number instead, and every gap is reported.
+//!
+//! With --generate it writes a synthetic stream instead, optionally with
+//! injected faults, so the verifier can be exercised without a board.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "crc32.h"
+#include "frame.h"
+#include "prng.h"
+}
+
+namespace {
+
+struct Options {
+	std::string input;          // empty: stdin
+	uint32_t seed = 1;
+	unsigned size = 80;         // payload bytes per frame (SEND_SIZE)
+	unsigned frames = 2500;     // frames per run (SEND_LOOP)
+	unsigned window = 64;       // frames searched ahead to resync after a drop
+	bool repeat = false;        // every frame carries the first payload (ExecuteTest)
+	bool generate = false;
+	bool framed = false;        // generator: emit framed lines
+	unsigned drop_every = 0;
+	unsigned truncate_every = 0;
+	unsigned corrupt_every = 0;
+};
+
+struct Stats {
+	uint64_t frames_ok = 0;
+	uint64_t dropped = 0;
+	uint64_t truncated = 0;
+	uint64_t corrupted = 0;
+};
+
+// Payloads of one run, generated on demand in stream order
+class PayloadSource {
+public:
+	PayloadSource(uint32_t seed, unsigned size, bool repeat)
+		: size_(size), repeat_(repeat)
+	{
+		PRNG_Seed(&prng_, seed);
+	}
+
+	const std::vector<uint8_t> &Get(uint64_t index)
+	{
+		if (repeat_)
+		{
+			index = 0;
+		}
+		while (payloads_.size() <= index)
+		{
+			std::vector<uint8_t> p(size_);
+			PRNG_Fill(&prng_, p.data(), p.size());
+			payloads_.push_back(std::move(p));
+		}
+		return payloads_[index];
+	}
+
+private:
+	PRNG_State prng_;
+	unsigned size_;
+	bool repeat_;
+	std::vector<std::vector<uint8_t>> payloads_;
+};
+
+int HexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	return -1;
+}
+
+bool ParseHex(const std::string &text, size_t pos, size_t chars, std::vector<uint8_t> &out)
+{
+	out.resize(chars / 2);
+	for (size_t i = 0; i < out.size(); i++)
+	{
+		int hi = HexValue(text[pos + 2 * i]);
+		int lo = HexValue(text[pos + 2 * i + 1]);
+		if (hi < 0 || lo < 0)
+		{
+			return false;
+		}
+		out[i] = (uint8_t)(hi << 4 | lo);
+	}
+	return true;
+}
+
+bool ParseU32(const std::string &text, size_t pos, uint32_t &value)
+{
+	std::vector<uint8_t> b;
+	if (!ParseHex(text, pos, 8, b))
+	{
+		return false;
+	}
+	value = (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+	return true;
+}
+
+bool IsHexLine(const std::string &line)
+{
+	if (line.empty())
+	{
+		return false;
+	}
+	for (char c : line)
+	{
+		if (HexValue(c) < 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Parameters of one run, from its seed line or the options
+struct RunHeader {
+	uint32_t seed;
+	unsigned frames;
+	bool repeat;
+	std::string label;
+};
+
+RunHeader DefaultHeader(const Options &opt, uint32_t seed)
+{
+	return { seed, opt.frames, opt.repeat, "" };
+}
+
+// "seed,<n>" optionally followed by ",<frames>,<repeat>,<label>"
+RunHeader ParseSeedLine(const Options &opt, const std::string &line)
+{
+	char *end;
+	RunHeader h = DefaultHeader(opt, (uint32_t)std::strtoul(line.c_str() + 5, &end, 0));
+	unsigned frames;
+	unsigned repeat;
+	int label = 0;
+
+	if (std::sscanf(end, ",%u,%u,%n", &frames, &repeat, &label) >= 2 && label > 0)
+	{
+		h.frames = frames;
+		h.repeat = repeat != 0;
+		h.label = end + label;
+	}
+	return h;
+}
+
+class Verifier {
+public:
+	explicit Verifier(const Options &opt) : opt_(opt), source_(opt.seed, opt.size, opt.repeat) {}
+
+	void StartRun(const RunHeader &header)
+	{
+		FinishRun();
+		header_ = header;
+		source_ = PayloadSource(header.seed, opt_.size, header.repeat);
+		next_ = 0;
+		seen_ = 0;
+		run_ = Stats();
+		active_ = true;
+	}
+
+	void Frame(const std::string &line)
+	{
+		if (!active_)
+		{
+			StartRun(DefaultHeader(opt_, opt_.seed));
+		}
+		if (header_.frames == 0)
+		{
+			return;
+		}
+		seen_++;
+
+		if (line.size() % 2 != 0 || line.size() > 2 * opt_.size)
+		{
+			run_.corrupted++;
+			next_++;
+			return;
+		}
+
+		std::vector<uint8_t> data(line.size() / 2);
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			data[i] = (uint8_t)(HexValue(line[2 * i]) << 4 | HexValue(line[2 * i + 1]));
+		}
+
+		if (data.size() < opt_.size)
+		{
+			run_.truncated++;
+			next_++;
+			return;
+		}
+
+		for (unsigned k = 0; k <= opt_.window; k++)
+		{
+			if (data == source_.Get(next_ + k))
+			{
+				run_.dropped += k;
+				run_.frames_ok++;
+				next_ += k + 1;
+				return;
+			}
+		}
+
+		run_.corrupted++;
+		next_++;
+	}
+
+	void FinishRun()
+	{
+		/* Runs without plain frames carried framed output only */
+		if (!active_ || seen_ == 0)
+		{
+			active_ = false;
+			return;
+		}
+		if (next_ < header_.frames)
+		{
+			run_.dropped += header_.frames - next_;
+		}
+		std::printf("run,seed=%u,label=%s,ok=%llu,dropped=%llu,truncated=%llu,corrupted=%llu\n",
+				header_.seed, header_.label.c_str(),
+				(unsigned long long)run_.frames_ok, (unsigned long long)run_.dropped,
+				(unsigned long long)run_.truncated, (unsigned long long)run_.corrupted);
+		total_.frames_ok += run_.frames_ok;
+		total_.dropped += run_.dropped;
+		total_.truncated += run_.truncated;
+		total_.corrupted += run_.corrupted;
+		active_ = false;
+	}
+
+	const Stats &Total() const { return total_; }
+
+private:
+	const Options &opt_;
+	PayloadSource source_;
+	RunHeader header_ = { 0, 0, false, "" };
+	uint64_t next_ = 0;
+	uint64_t seen_ = 0;
+	bool active_ = false;
+	Stats run_;
+	Stats total_;
+};
+
+// Decoder for lines written by FRAME_Encode
+class FrameDecoder {
+public:
+	void Line(const std::string &line)
+	{
+		uint32_t seq;
+		uint32_t crc;
+		std::vector<uint8_t> payload;
+		size_t n = line.size();
+
+		if (n < 19 || line[9] != ':' || line[n - 9] != ':' || (n - 19) % 2 != 0 ||
+				!ParseU32(line, 1, seq) || !ParseU32(line, n - 8, crc) ||
+				!ParseHex(line, 10, n - 19, payload))
+		{
+			malformed_++;
+			return;
+		}
+
+		uint8_t le[4] = { (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24) };
+		uint32_t check = CRC32_Update(0, le, sizeof(le));
+		check = CRC32_Update(check, payload.data(), payload.size());
+		if (check != crc)
+		{
+			// The sequence number itself cannot be trusted
+			crc_errors_++;
+			return;
+		}
+
+		if (have_last_)
+		{
+			if (seq == 0)
+			{
+				restarts_++;
+			}
+			else if (seq > last_ + 1)
+			{
+				std::printf("gap,after=%u,missing=%u\n", last_, seq - last_ - 1);
+				missing_ += seq - last_ - 1;
+			}
+			else if (seq <= last_)
+			{
+				reordered_++;
+			}
+		}
+		have_last_ = true;
+		last_ = seq;
+		ok_++;
+	}
+
+	bool Seen() const { return ok_ || malformed_ || crc_errors_; }
+	bool Failed() const { return missing_ || crc_errors_ || malformed_ || reordered_; }
+
+	void Report() const
+	{
+		std::printf("framed,ok=%llu,missing=%llu,crc_errors=%llu,malformed=%llu,reordered=%llu,restarts=%llu\n",
+				(unsigned long long)ok_, (unsigned long long)missing_,
+				(unsigned long long)crc_errors_, (unsigned long long)malformed_,
+				(unsigned long long)reordered_, (unsigned long long)restarts_);
+	}
+
+private:
+	bool have_last_ = false;
+	uint32_t last_ = 0;
+	uint64_t ok_ = 0;
+	uint64_t missing_ = 0;
+	uint64_t crc_errors_ = 0;
+	uint64_t malformed_ = 0;
+	uint64_t reordered_ = 0;
+	uint64_t restarts_ = 0;
+};
+
+int Verify(const Options &opt)
+{
+	std::ifstream file;
+	std::istream *in = &std::cin;
+
+	if (!opt.input.empty())
+	{
+		file.open(opt.input, std::ios::binary);
+		if (!file)
+		{
+			std::fprintf(stderr, "rtt_verify: cannot open %s\n", opt.input.c_str());
+			return 2;
+		}
+		in = &file;
+	}
+
+	Verifier verifier(opt);
+	FrameDecoder framed;
+	std::string line;
+	uint64_t bytes = 0;
+	auto first = std::chrono::steady_clock::now();
+	auto last = first;
+	bool started = false;
+
+	while (std::getline(*in, line))
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (!started)
+		{
+			first = now;
+			started = true;
+		}
+		last = now;
+		bytes += line.size() + 1;
+
+		if (!line.empty() && line.back() == '\r')
+		{
+			line.pop_back();
+		}
+
+		if (line.compare(0, 5, "seed,") == 0)
+		{
+			verifier.StartRun(ParseSeedLine(opt, line));
+		}
+		else if (line.size() > 9 && line[0] == 'F' && line[9] == ':')
+		{
+			framed.Line(line);
+		}
+		else if (IsHexLine(line))
+		{
+			verifier.Frame(line);
+		}
+	}
+	verifier.FinishRun();
+	if (framed.Seen())
+	{
+		framed.Report();
+	}
+
+	const Stats &t = verifier.Total();
+	double seconds = std::chrono::duration<double>(last - first).count();
+	std::printf("total,ok=%llu,dropped=%llu,truncated=%llu,corrupted=%llu\n",
+			(unsigned long long)t.frames_ok, (unsigned long long)t.dropped,
+			(unsigned long long)t.truncated, (unsigned long long)t.corrupted);
+	std::printf("throughput,bytes=%llu,seconds=%.3f,bytes_per_s=%.0f\n",
+			(unsigned long long)bytes, seconds, seconds > 0 ? bytes / seconds : 0.0);
+
+	return (t.dropped || t.truncated || t.corrupted || framed.Failed()) ? 1 : 0;
+}
+
+// Synthetic stream in the same format the device sends
+int Generate(const Options &opt)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	PayloadSource source(opt.seed, opt.size, opt.repeat);
+	std::string line;
+
+	std::printf("Send %u * %u bytes of data\nseed,%u,%u,%u,generate\n", opt.frames, opt.size,
+			opt.seed, opt.frames, opt.repeat ? 1u : 0u);
+	for (unsigned i = 0; i < opt.frames; i++)
+	{
+		unsigned n = i + 1;
+		if (opt.drop_every && n % opt.drop_every == 0)
+		{
+			continue;
+		}
+
+		const std::vector<uint8_t> &p = source.Get(i);
+		if (opt.framed)
+		{
+			line.resize(FRAME_ENCODED_SIZE(p.size()));
+			line.resize(FRAME_Encode(&line[0], i, p.data(), p.size()) - 1);
+		}
+		else
+		{
+			line.clear();
+			for (uint8_t b : p)
+			{
+				line.push_back(hex[b >> 4]);
+				line.push_back(hex[b & 0x0f]);
+			}
+		}
+		if (opt.truncate_every && n % opt.truncate_every == 0)
+		{
+			line.resize(line.size() / 2);
+		}
+		if (opt.corrupt_every && n % opt.corrupt_every == 0)
+		{
+			char &c = line[line.size() / 2];
+			c = (c == '0') ? '1' : '0';
+		}
+		std::fwrite(line.data(), 1, line.size(), stdout);
+		std::fputc('\n', stdout);
+	}
+
+	return 0;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: rtt_verify [options] [capture]\n"
+			"  --seed N            seed used until a seed,<n> line is read (1)\n"
+			"  --size N            payload bytes per frame (80)\n"
+			"  --frames N          frames per run without a count in its seed line (2500)\n"
+			"  --window N          frames searched ahead after a mismatch (64)\n"
+			"  --repeat            same, every frame repeats the first payload\n"
+			"  --generate          write a synthetic stream to stdout\n"
+			"  --framed            generator: write FRAME_Encode lines\n"
+			"  --drop-every N      generator: leave out every Nth frame\n"
+			"  --truncate-every N  generator: cut every Nth frame in half\n"
+			"  --corrupt-every N   generator: flip a digit in every Nth frame\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	CRC32_Initialize();
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--size") opt.size = (unsigned)value();
+		else if (arg == "--frames") opt.frames = (unsigned)value();
+		else if (arg == "--window") opt.window = (unsigned)value();
+		else if (arg == "--repeat") opt.repeat = true;
+		else if (arg == "--generate") opt.generate = true;
+		else if (arg == "--framed") opt.framed = true;
+		else if (arg == "--drop-every") opt.drop_every = (unsigned)value();
+		else if (arg == "--truncate-every") opt.truncate_every = (unsigned)value();
+		else if (arg == "--corrupt-every") opt.corrupt_every = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else if (!arg.empty() && arg[0] == '-' && arg != "-")
+		{
+			Usage();
+			return 2;
+		}
+		else if (arg != "-") opt.input = arg;
+	}
+
+	return opt.generate ? Generate(opt) : Verify(opt);
+}
@@ -0,0 +1,344 @@
+//-----------------------------------------------------------------------------
+//! \file staging_stress.cpp
+//!
+//! Host stress test of the staging ring (rtt_staging.h) with threads.
+//!
+//! Several producer threads write numbered records of random length, half
+//! with RTT_StagingWrite and half with Reserve, fill and Commit, while one
+//! consumer thread drains the ring into a simulated RTT channel. The
+//! channel accepts only part of a write (or nothing) on a given share of
+//! the calls, like a nearly full up-buffer in trim mode.
+//!
+//! Every payload starts with its length, producer and sequence number and
+//! is followed by a pattern, so the drained byte stream can be split back
+//! into records. The test fails if a record is corrupted, cut short,
+//! delivered out of order per producer or twice, if an accepted record
+//! is missing, or if the written and dropped counters of the ring do not
+//! match the bytes delivered and rejected:
+//!
+//!     staging,producers,records,delivered,dropped,written,dropped_bytes,short_writes
+//!
+//! The exit status is 1 on failure.
+//-----------------------------------------------------------------------------
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "rtt_staging.h"
+}
+
+namespace {
+
+struct Options {
+	unsigned producers = 4;
+	unsigned records = 200000;      // per producer
+	unsigned ring = 1024;           // staging ring size in bytes
+	unsigned max_len = 60;          // longest pattern after the record header
+	unsigned short_pct = 30;        // drain writes only partly accepted
+	uint32_t seed = 1;
+};
+
+const unsigned HEADER = 7;          // length, producer, sequence number
+
+uint8_t Pattern(unsigned producer, uint32_t seq, unsigned i)
+{
+	return (uint8_t)(seq * 31 + producer * 7 + i);
+}
+
+void Fill(uint8_t *p, unsigned len, unsigned producer, uint32_t seq)
+{
+	p[0] = (uint8_t)len;
+	p[1] = (uint8_t)(len >> 8);
+	p[2] = (uint8_t)producer;
+	std::memcpy(p + 3, &seq, 4);
+	for (unsigned i = HEADER; i < len; i++)
+	{
+		p[i] = Pattern(producer, seq, i);
+	}
+}
+
+// Simulated RTT channel, only called from the consumer thread
+struct Channel {
+	std::string out;
+	std::mt19937 rng;
+	unsigned short_pct = 0;
+	unsigned long short_writes = 0;
+};
+
+Channel channel;
+
+unsigned ChannelWrite(unsigned ch, const void *data, unsigned len)
+{
+	unsigned n = len;
+
+	(void)ch;
+	if (channel.rng() % 100 < channel.short_pct)
+	{
+		n = channel.rng() % (len + 1);
+		channel.short_writes += n < len;
+	}
+	channel.out.append((const char *)data, n);
+	return n;
+}
+
+struct Producer {
+	std::vector<uint8_t> accepted;  // per sequence number
+	unsigned long dropped = 0;
+	unsigned long dropped_bytes = 0;
+};
+
+void Produce(RTT_Staging *ring, Producer &p, unsigned id, const Options &opt)
+{
+	std::mt19937 rng(opt.seed * 977 + id);
+	std::vector<uint8_t> buf(HEADER + opt.max_len);
+
+	p.accepted.assign(opt.records, 0);
+	for (uint32_t seq = 0; seq < opt.records; seq++)
+	{
+		unsigned len = HEADER + rng() % (opt.max_len + 1);
+		bool ok;
+
+		if (seq & 1)
+		{
+			Fill(buf.data(), len, id, seq);
+			ok = RTT_StagingWrite(ring, buf.data(), len);
+		}
+		else
+		{
+			void *record = RTT_StagingReserve(ring, len);
+
+			ok = record != nullptr;
+			if (ok)
+			{
+				Fill((uint8_t *)record, len, id, seq);
+				RTT_StagingCommit(ring, record);
+			}
+		}
+
+		p.accepted[seq] = ok;
+		if (!ok)
+		{
+			p.dropped++;
+			p.dropped_bytes += len;
+		}
+		// Let the other threads run on a single core
+		if ((seq % 13) == 0)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+// Split the drained stream into records and check them against the producers
+unsigned Check(const std::vector<Producer> &producers, unsigned long &delivered)
+{
+	const std::string &s = channel.out;
+	std::vector<uint32_t> next(producers.size(), 0);
+	unsigned errors = 0;
+	size_t pos = 0;
+
+	auto fail = [&](const char *what, size_t at) {
+		if (errors++ < 10)
+		{
+			std::printf("staging,ERROR,%s at byte %zu\n", what, at);
+		}
+	};
+
+	delivered = 0;
+	while (pos < s.size())
+	{
+		const uint8_t *p = (const uint8_t *)s.data() + pos;
+		unsigned len;
+		unsigned id;
+		uint32_t seq;
+
+		if (s.size() - pos < HEADER)
+		{
+			fail("truncated header", pos);
+			break;
+		}
+		len = p[0] | p[1] << 8;
+		id = p[2];
+		std::memcpy(&seq, p + 3, 4);
+		if (len < HEADER || len > s.size() - pos || id >= producers.size() ||
+				seq >= producers[id].accepted.size())
+		{
+			fail("bad record header", pos);
+			break;
+		}
+
+		// Everything skipped since the last record of this producer was dropped
+		if (seq < next[id])
+		{
+			fail("record out of order or repeated", pos);
+		}
+		for (uint32_t k = next[id]; k < seq; k++)
+		{
+			if (producers[id].accepted[k])
+			{
+				fail("accepted record missing", pos);
+				break;
+			}
+		}
+		if (!producers[id].accepted[seq])
+		{
+			fail("dropped record delivered", pos);
+		}
+		for (unsigned i = HEADER; i < len; i++)
+		{
+			if (p[i] != Pattern(id, seq, i))
+			{
+				fail("corrupted payload", pos);
+				break;
+			}
+		}
+
+		next[id] = seq + 1;
+		delivered++;
+		pos += len;
+	}
+
+	for (size_t id = 0; id < producers.size(); id++)
+	{
+		for (uint32_t k = next[id]; k < producers[id].accepted.size(); k++)
+		{
+			if (producers[id].accepted[k])
+			{
+				fail("accepted record missing at the end", s.size());
+				break;
+			}
+		}
+	}
+	return errors;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: staging_stress [options]\n"
+			"  --producers N       producer threads (4)\n"
+			"  --records N         records per producer (200000)\n"
+			"  --ring N            staging ring size, power of two (1024)\n"
+			"  --max-len N         longest payload after the 7 byte header (60)\n"
+			"  --short N           percent of drain writes only partly accepted (30)\n"
+			"  --seed N            random sequence (1)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--producers") opt.producers = (unsigned)value();
+		else if (arg == "--records") opt.records = (unsigned)value();
+		else if (arg == "--ring") opt.ring = (unsigned)value();
+		else if (arg == "--max-len") opt.max_len = (unsigned)value();
+		else if (arg == "--short") opt.short_pct = (unsigned)value();
+		else if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.producers == 0 || opt.producers > 255 || opt.ring < 64 || (opt.ring & (opt.ring - 1)) ||
+			opt.short_pct > 100 || HEADER + opt.max_len > RTT_STAGING_MAX_RECORD)
+	{
+		Usage();
+		return 2;
+	}
+
+	std::vector<uint32_t> storage(opt.ring / 4);
+	RTT_Staging ring;
+	std::vector<Producer> producers(opt.producers);
+	std::vector<std::thread> threads;
+	std::atomic<unsigned> running(opt.producers);
+
+	RTT_StagingInit(&ring, storage.data(), opt.ring);
+	channel.rng.seed(opt.seed);
+	channel.short_pct = opt.short_pct;
+
+	std::thread consumer([&]() {
+		for (;;)
+		{
+			bool finished = running == 0;
+
+			RTT_StagingDrain(&ring, ChannelWrite, 0);
+			if (ring.tail == ring.head)
+			{
+				if (finished)
+				{
+					break;
+				}
+				std::this_thread::yield();
+			}
+		}
+	});
+	for (unsigned id = 0; id < opt.producers; id++)
+	{
+		threads.emplace_back([&, id]() {
+			Produce(&ring, producers[id], id, opt);
+			running--;
+		});
+	}
+	for (std::thread &t : threads)
+	{
+		t.join();
+	}
+	consumer.join();
+
+	unsigned long records = (unsigned long)opt.producers * opt.records;
+	unsigned long dropped = 0;
+	unsigned long dropped_bytes = 0;
+	unsigned long delivered;
+	for (const Producer &p : producers)
+	{
+		dropped += p.dropped;
+		dropped_bytes += p.dropped_bytes;
+	}
+	unsigned errors = Check(producers, delivered);
+
+	if (delivered + dropped != records || ring.dropped != dropped_bytes ||
+			ring.written != channel.out.size())
+	{
+		std::printf("staging,ERROR,counters: ring written %lu dropped %lu, stream %zu, dropped %lu\n",
+				(unsigned long)ring.written, (unsigned long)ring.dropped, channel.out.size(),
+				dropped_bytes);
+		errors++;
+	}
+
+	std::printf("staging,%u,%lu,%lu,%lu,%lu,%lu,%lu\n", opt.producers, records, delivered, dropped,
+			(unsigned long)ring.written, dropped_bytes, channel.short_writes);
+	if (errors)
+	{
+		std::printf("staging,FAILED,%u\n", errors);
+		return 1;
+	}
+	return 0;
+}
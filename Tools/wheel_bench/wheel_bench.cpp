@@ -0,0 +1,279 @@
+//-----------------------------------------------------------------------------
+//! \file wheel_bench.cpp
+//!
+//! Host benchmark of the timing wheel (wheel.h) with many concurrent timers.
+//!
+//! N timers run with delays spread evenly on a log scale from 10 us to 10 s
+//! (one tick per microsecond). Each expired timer rearms itself with a new
+//! random delay and every step some timers are cancelled and armed again,
+//! like retry timeouts that are reset by traffic. Time advances in steps of
+//! 1 ms, the SwTimer resolution.
+//!
+//! The same workload runs on the wheel and on an unsorted list that is
+//! scanned at every step, the way a linear software timer list works. The
+//! wheel run also checks that every callback runs exactly at its expiry.
+//! Cancelling and rearming is timed per batch of one step and reported per
+//! timer; the step time includes running and rearming the expired timers.
+//!
+//!     wheel,impl,timers,steps,expired,reset_ns,step_ns,cascaded
+//-----------------------------------------------------------------------------
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "timing.h"
+#include "wheel.h"
+}
+
+namespace {
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned steps = 20000;
+	unsigned step_us = 1000;
+	unsigned resets = 8;        // timers cancelled and rearmed per step
+	std::vector<unsigned> timers = { 100, 1000, 10000 };
+};
+
+// Delays from 10 us to 10 s, uniform in log(delay)
+class DelaySource {
+public:
+	explicit DelaySource(uint32_t seed) : rng_(seed), exp_(std::log(10.0), std::log(1e7)) {}
+	uint32_t Next() { return (uint32_t)std::exp(exp_(rng_)); }
+	uint32_t Pick(size_t n) { return (uint32_t)(rng_() % n); }
+
+private:
+	std::mt19937 rng_;
+	std::uniform_real_distribution<double> exp_;
+};
+
+struct Totals {
+	uint64_t reset_ticks = 0;
+	uint64_t resets = 0;
+	uint64_t step_ticks = 0;
+	uint64_t expired = 0;
+	uint64_t errors = 0;
+	uint64_t cascaded = 0;
+};
+
+void Print(const char *impl, size_t n, unsigned steps, const Totals &t)
+{
+	double ns = 1e9 / TIMING_TickHz();
+
+	std::printf("wheel,%s,%zu,%u,%llu,%.1f,%.1f,%llu\n", impl, n, steps,
+			(unsigned long long)t.expired,
+			t.resets ? t.reset_ticks * ns / t.resets : 0.0,
+			t.step_ticks * ns / steps, (unsigned long long)t.cascaded);
+}
+
+// Wheel ----------------------------------------------------------------------
+
+struct WheelTimer {
+	WHEEL_Timer timer;
+	uint32_t expiry;
+};
+
+WHEEL_Wheel wheel;
+DelaySource *wheel_delays;
+Totals *wheel_totals;
+
+void WheelArm(WheelTimer *t, uint32_t delay)
+{
+	t->expiry = wheel.now + delay;
+	WHEEL_Start(&wheel, &t->timer, t->expiry);
+}
+
+void WheelExpired(void *arg)
+{
+	WheelTimer *t = static_cast<WheelTimer *>(arg);
+
+	if (wheel.now != t->expiry)
+	{
+		wheel_totals->errors++;
+	}
+	wheel_totals->expired++;
+	WheelArm(t, wheel_delays->Next());
+}
+
+Totals RunWheel(const Options &opt, size_t n)
+{
+	DelaySource delays(opt.seed);
+	std::vector<WheelTimer> timers(n);
+	Totals totals;
+	uint32_t now = 0u - 100000000u;
+
+	wheel_delays = &delays;
+	wheel_totals = &totals;
+	WHEEL_Init(&wheel, now);
+	for (WheelTimer &t : timers)
+	{
+		WHEEL_TimerInit(&t.timer, WheelExpired, &t);
+		WheelArm(&t, delays.Next());
+	}
+	totals = Totals();
+
+	for (unsigned s = 0; s < opt.steps; s++)
+	{
+		uint32_t start = TIMING_Now();
+		for (unsigned r = 0; r < opt.resets; r++)
+		{
+			WheelTimer &t = timers[delays.Pick(n)];
+
+			WHEEL_Cancel(&wheel, &t.timer);
+			WheelArm(&t, delays.Next());
+		}
+		totals.reset_ticks += TIMING_Now() - start;
+		totals.resets += opt.resets;
+
+		now += opt.step_us;
+		start = TIMING_Now();
+		WHEEL_Advance(&wheel, now);
+		totals.step_ticks += TIMING_Now() - start;
+	}
+
+	// Rearming from callbacks is counted in the step time as well
+	totals.cascaded = wheel.cascaded;
+	if (wheel.armed != n)
+	{
+		totals.errors++;
+	}
+	return totals;
+}
+
+// Linear list ----------------------------------------------------------------
+
+struct ListTimer {
+	uint32_t expiry;
+	bool armed;
+};
+
+Totals RunList(const Options &opt, size_t n)
+{
+	DelaySource delays(opt.seed);
+	std::vector<ListTimer> timers(n);
+	Totals totals;
+	uint32_t now = 0u - 100000000u;
+
+	for (ListTimer &t : timers)
+	{
+		t.expiry = now + delays.Next();
+		t.armed = true;
+	}
+
+	for (unsigned s = 0; s < opt.steps; s++)
+	{
+		uint32_t start = TIMING_Now();
+		for (unsigned r = 0; r < opt.resets; r++)
+		{
+			ListTimer &t = timers[delays.Pick(n)];
+
+			t.armed = false;
+			t.expiry = now + delays.Next();
+			t.armed = true;
+		}
+		totals.reset_ticks += TIMING_Now() - start;
+		totals.resets += opt.resets;
+
+		now += opt.step_us;
+		start = TIMING_Now();
+		for (ListTimer &t : timers)
+		{
+			if (t.armed && (int32_t)(now - t.expiry) >= 0)
+			{
+				totals.expired++;
+				t.expiry = now + delays.Next();
+			}
+		}
+		totals.step_ticks += TIMING_Now() - start;
+	}
+	return totals;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: wheel_bench [options]\n"
+			"  --seed N            random sequence (1)\n"
+			"  --steps N           simulated steps (20000)\n"
+			"  --step-us N         time per step (1000)\n"
+			"  --resets N          timers cancelled and rearmed per step (8)\n"
+			"  --timers N          concurrent timers, repeat for several (100 1000 10000)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+	bool timers_given = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--steps") opt.steps = (unsigned)value();
+		else if (arg == "--step-us") opt.step_us = (unsigned)value();
+		else if (arg == "--resets") opt.resets = (unsigned)value();
+		else if (arg == "--timers")
+		{
+			if (!timers_given)
+			{
+				opt.timers.clear();
+				timers_given = true;
+			}
+			opt.timers.push_back((unsigned)value());
+		}
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	for (unsigned n : opt.timers)
+	{
+		if (n == 0 || opt.steps == 0 || opt.step_us == 0 || opt.step_us > 0x7fffffffu)
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	TIMING_Initialize();
+	uint64_t errors = 0;
+	for (unsigned n : opt.timers)
+	{
+		Totals wheel_result = RunWheel(opt, n);
+		Totals list_result = RunList(opt, n);
+
+		Print("wheel", n, opt.steps, wheel_result);
+		Print("list", n, opt.steps, list_result);
+		errors += wheel_result.errors;
+	}
+
+	if (errors)
+	{
+		std::printf("wheel,FAILED,%llu\n", (unsigned long long)errors);
+		return 1;
+	}
+	return 0;
+}
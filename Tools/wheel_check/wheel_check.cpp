@@ -0,0 +1,313 @@
+//-----------------------------------------------------------------------------
+//! \file wheel_check.cpp
+//!
+//! Randomized host test of the timing wheel (wheel.h) against a reference
+//! model.
+//!
+//! The model keeps the expiry and arming order of every timer in a plain
+//! array. Each step arms, rearms and cancels random timers with delays from
+//! 1 tick up to WHEEL_MAX_DELAY, checks WHEEL_NextExpiry and
+//! WHEEL_NextEvent against the earliest expiry of the model, and advances
+//! by a few ticks, up to 100 ms at 1 us per tick, or up to 2^28 ticks, so
+//! that the clock wraps and the overflow list is used. Some callbacks arm
+//! their own timer again.
+//!
+//! The test fails if a callback runs for a timer that is not armed, at any
+//! time but its expiry, out of expiry order or, for equal expiries, out of
+//! arming order; if an advance leaves an expired timer armed; if the armed
+//! count differs from the model; or if the next expiry differs from the
+//! model. One line is printed per seed:
+//!
+//!     wheel_check,seed,steps,timers,fired,cascaded,errors
+//!
+//! The exit status is 1 if any seed failed.
+//-----------------------------------------------------------------------------
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "wheel.h"
+}
+
+namespace {
+
+struct Options {
+	uint32_t seed = 1;
+	unsigned seeds = 20;
+	unsigned steps = 20000;
+	unsigned timers = 1000;
+};
+
+struct ModelTimer {
+	WHEEL_Timer timer;
+	uint32_t expiry;
+	uint64_t order;             // arming order, equal expiries fire by it
+	bool armed;
+	bool rearm;                 // callback arms the timer again
+};
+
+WHEEL_Wheel wheel;
+std::vector<ModelTimer> model;
+std::mt19937 rng;
+uint64_t armed_count;
+uint64_t next_order;
+uint64_t fired;
+unsigned errors;
+bool have_last;
+uint32_t last_expiry;
+uint64_t last_order;
+
+void Error(const std::string &what)
+{
+	if (errors++ < 10)
+	{
+		std::printf("wheel_check,ERROR,%s\n", what.c_str());
+	}
+}
+
+// Delay of 1 tick up to WHEEL_MAX_DELAY - 1, spread over all magnitudes
+uint32_t RandomDelay()
+{
+	unsigned bits = rng() % 32;
+	uint32_t d = (bits >= 31) ? rng() & 0x7fffffffu : rng() & ((1u << bits) - 1);
+
+	if (d == 0)
+	{
+		d = 1;
+	}
+	return (d < WHEEL_MAX_DELAY) ? d : WHEEL_MAX_DELAY - 1;
+}
+
+void Arm(ModelTimer &t, uint32_t delay)
+{
+	armed_count += !t.armed;
+	t.expiry = wheel.now + delay;
+	t.order = next_order++;
+	t.armed = true;
+	WHEEL_Start(&wheel, &t.timer, t.expiry);
+}
+
+void Expired(void *arg)
+{
+	ModelTimer &t = *static_cast<ModelTimer *>(arg);
+
+	if (!t.armed)
+	{
+		Error("callback of a timer that is not armed");
+	}
+	else if (wheel.now != t.expiry)
+	{
+		Error("fired at " + std::to_string(wheel.now) + ", expiry " + std::to_string(t.expiry));
+	}
+	if (have_last && (int32_t)(t.expiry - last_expiry) < 0)
+	{
+		Error("fired out of expiry order");
+	}
+	if (have_last && t.expiry == last_expiry && t.order < last_order)
+	{
+		Error("equal expiries fired out of arming order");
+	}
+	have_last = true;
+	last_expiry = t.expiry;
+	last_order = t.order;
+
+	t.armed = false;
+	armed_count--;
+	fired++;
+	if (t.rearm)
+	{
+		Arm(t, RandomDelay());
+	}
+}
+
+// Earliest expiry of the model and the wheel's view of it
+void CheckNext()
+{
+	bool any = false;
+	uint32_t min = 0;
+	uint32_t expiry;
+	uint32_t event;
+	bool has_expiry = WHEEL_NextExpiry(&wheel, &expiry);
+	bool has_event = WHEEL_NextEvent(&wheel, &event);
+
+	for (const ModelTimer &t : model)
+	{
+		if (t.armed && (!any || t.expiry - wheel.now < min))
+		{
+			min = t.expiry - wheel.now;
+			any = true;
+		}
+	}
+
+	if (has_expiry != any || has_event != any)
+	{
+		Error("next expiry reported with the wrong armed state");
+	}
+	else if (any && expiry != min)
+	{
+		Error("next expiry " + std::to_string(expiry) + " ticks, model " + std::to_string(min));
+	}
+	else if (any && event > min)
+	{
+		Error("next event after the earliest expiry");
+	}
+}
+
+unsigned RunSeed(uint32_t seed, const Options &opt)
+{
+	uint32_t start;
+
+	rng.seed(seed);
+	errors = 0;
+	fired = 0;
+	armed_count = 0;
+	next_order = 0;
+
+	// Start just before a wrap, just before bit 30 changes, or anywhere
+	switch (seed % 3)
+	{
+	case 0:
+		start = 0u - 3000000u;
+		break;
+	case 1:
+		start = (1u << WHEEL_RANGE_BITS) - 1000u;
+		break;
+	default:
+		start = rng();
+		break;
+	}
+
+	WHEEL_Init(&wheel, start);
+	model.assign(opt.timers, ModelTimer());
+	for (ModelTimer &t : model)
+	{
+		t.armed = false;
+		t.rearm = rng() % 8 == 0;
+		WHEEL_TimerInit(&t.timer, Expired, &t);
+	}
+
+	for (unsigned step = 0; step < opt.steps; step++)
+	{
+		unsigned changes = rng() % 4;
+
+		for (unsigned i = 0; i < changes; i++)
+		{
+			ModelTimer &t = model[rng() % model.size()];
+
+			if (rng() % 5 == 0)
+			{
+				armed_count -= t.armed;
+				t.armed = false;
+				WHEEL_Cancel(&wheel, &t.timer);
+			}
+			else
+			{
+				Arm(t, RandomDelay());
+			}
+		}
+
+		CheckNext();
+
+		uint32_t advance;
+		switch (rng() % 3)
+		{
+		case 0:
+			advance = rng() % 4;
+			break;
+		case 1:
+			advance = rng() % 100000;
+			break;
+		default:
+			advance = rng() % (1u << 28);
+			break;
+		}
+		have_last = false;
+		WHEEL_Advance(&wheel, wheel.now + advance);
+
+		for (const ModelTimer &t : model)
+		{
+			if (t.armed && (int32_t)(t.expiry - wheel.now) <= 0)
+			{
+				Error("expiry " + std::to_string(t.expiry) + " missed at " + std::to_string(wheel.now));
+				break;
+			}
+		}
+		if (wheel.armed != armed_count)
+		{
+			Error("armed count " + std::to_string(wheel.armed) + ", model " + std::to_string(armed_count));
+			break;
+		}
+	}
+
+	std::printf("wheel_check,%lu,%u,%u,%llu,%lu,%u\n", (unsigned long)seed, opt.steps, opt.timers,
+			(unsigned long long)fired, (unsigned long)wheel.cascaded, errors);
+	return errors;
+}
+
+void Usage()
+{
+	std::fprintf(stderr,
+			"usage: wheel_check [options]\n"
+			"  --seed N            first random sequence (1)\n"
+			"  --seeds N           number of sequences (20)\n"
+			"  --steps N           advances per sequence (20000)\n"
+			"  --timers N          timers per sequence (1000)\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	Options opt;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		auto value = [&]() -> unsigned long {
+			if (i + 1 >= argc)
+			{
+				Usage();
+				std::exit(2);
+			}
+			return std::strtoul(argv[++i], nullptr, 0);
+		};
+
+		if (arg == "--seed") opt.seed = (uint32_t)value();
+		else if (arg == "--seeds") opt.seeds = (unsigned)value();
+		else if (arg == "--steps") opt.steps = (unsigned)value();
+		else if (arg == "--timers") opt.timers = (unsigned)value();
+		else if (arg == "-h" || arg == "--help")
+		{
+			Usage();
+			return 0;
+		}
+		else
+		{
+			Usage();
+			return 2;
+		}
+	}
+
+	if (opt.seeds == 0 || opt.timers == 0)
+	{
+		Usage();
+		return 2;
+	}
+
+	unsigned failed = 0;
+	for (unsigned i = 0; i < opt.seeds; i++)
+	{
+		failed += RunSeed(opt.seed + i, opt) != 0;
+	}
+
+	if (failed)
+	{
+		std::printf("wheel_check,FAILED,%u\n", failed);
+		return 1;
+	}
+	return 0;
+}